@@ -4,8 +4,10 @@ rmdir build /s /q
 mkdir build
 copy src\*.glsl build\
 copy src\*.ttf build\
-cl src\main.c /I.\include\ /O2 /MD /DWIN32 /EHsc /nologo /link lib\GLFW\glfw3.lib opengl32.lib user32.lib gdi32.lib msvcrt.lib shell32.lib /OUT:"build/main_console.exe" /SUBSYSTEM:CONSOLE
-cl src\main.c /I.\include\ /O2 /MD /DWIN32 /EHsc /nologo /link lib\GLFW\glfw3.lib opengl32.lib user32.lib gdi32.lib msvcrt.lib shell32.lib /OUT:"build/main.exe" /SUBSYSTEM:WINDOWS /ENTRY:"mainCRTStartup"
+cl /c src\graph.c /O2 /MD /DWIN32 /nologo /Fo"build/graph.obj"
+lib /nologo build\graph.obj /OUT:"build/graph.lib"
+cl src\main.c /I.\include\ /O2 /MD /DWIN32 /EHsc /nologo /link build\graph.lib lib\GLFW\glfw3.lib opengl32.lib user32.lib gdi32.lib msvcrt.lib shell32.lib /OUT:"build/main_console.exe" /SUBSYSTEM:CONSOLE
+cl src\main.c /I.\include\ /O2 /MD /DWIN32 /EHsc /nologo /link build\graph.lib lib\GLFW\glfw3.lib opengl32.lib user32.lib gdi32.lib msvcrt.lib shell32.lib /OUT:"build/main.exe" /SUBSYSTEM:WINDOWS /ENTRY:"mainCRTStartup"
 pushd build
 main_console.exe
 popd
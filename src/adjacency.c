@@ -0,0 +1,415 @@
+// compressed sparse row (CSR) adjacency store
+//
+// the out-edges of a vertex live in two places: a contiguous segment of the shared csr array
+// (row.start .. row.start + row.num_base) and a small growable overflow array that receives the
+// edges added since the last compaction. adjacency_compact() merges every overflow back into a
+// freshly packed csr array, so bulk operations should call it once they are done. csr segments are
+// kept sorted by destination, so lookups binary search them and only scan the (short) overflow.
+//
+// bulk insertions (see adjacency_append_edge) skip the reciprocal lookup and leave the flags to be
+// recomputed by the next compaction.
+//
+// vertices are stable slots: removing a vertex frees its slot (to be reused by the next
+// adjacency_add_vertex) without renumbering any other vertex. every vertex also keeps the list of
+// its parents (sources of its in-edges) so that removing it only touches its own edges.
+//
+// NOTE: edge pointers returned by this API are only valid until the next mutation
+
+// NOTE: the types are declared in graph.h
+
+void adjacency_init(adjacency_t *adj) {
+    adj->rows = NULL;
+    adj->num_rows = 0;
+    adj->rows_capacity = 0;
+    adj->num_vertices = 0;
+    adj->free_rows = NULL;
+    adj->num_free_rows = 0;
+    adj->free_rows_capacity = 0;
+    adj->csr = NULL;
+    adj->csr_size = 0;
+    adj->num_edges = 0;
+    adj->version = 0;
+}
+
+void adjacency_destroy(adjacency_t *adj) {
+    for (int i = 0; i < adj->num_rows; i++) {
+        free(adj->rows[i].overflow);
+        free(adj->rows[i].parents);
+    }
+    free(adj->rows);
+    free(adj->free_rows);
+    free(adj->csr);
+    int version = adj->version;
+    adjacency_init(adj);
+    adj->version = version + 1;
+}
+
+bool adjacency_is_vertex(adjacency_t *adj, int v) {
+    return v >= 0 && v < adj->num_rows && adj->rows[v].alive;
+}
+
+// NOTE: free slots have no edges, so they can be iterated over like any other vertex
+int adjacency_degree(adjacency_t *adj, int v) {
+    assert(v >= 0 && v < adj->num_rows);
+    return adj->rows[v].num_base + adj->rows[v].num_overflow;
+}
+
+int adjacency_in_degree(adjacency_t *adj, int v) {
+    assert(v >= 0 && v < adj->num_rows);
+    return adj->rows[v].num_parents;
+}
+
+// returns the k-th out-edge of v, 0 <= k < adjacency_degree(adj, v)
+edge_t *adjacency_edge(adjacency_t *adj, int v, int k) {
+    adjacency_row_t *row = &adj->rows[v];
+    assert(k >= 0 && k < row->num_base + row->num_overflow);
+    if (k < row->num_base) {
+        return &adj->csr[row->start + k];
+    }
+    return &row->overflow[k - row->num_base];
+}
+
+// returns the k-th parent of v (source of an in-edge), 0 <= k < adjacency_in_degree(adj, v)
+int adjacency_parent(adjacency_t *adj, int v, int k) {
+    assert(k >= 0 && k < adj->rows[v].num_parents);
+    return adj->rows[v].parents[k];
+}
+
+// returns the position of the out-edge orig -> dest (as used by adjacency_edge), or -1 if there is none
+int adjacency_find_edge_index(adjacency_t *adj, int orig, int dest) {
+    adjacency_row_t *row = &adj->rows[orig];
+    edge_t *base = &adj->csr[row->start];
+    int low = 0;
+    int high = row->num_base - 1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        if (base[middle].dest == dest) {
+            return middle;
+        } else if (base[middle].dest < dest) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    for (int k = 0; k < row->num_overflow; k++) {
+        if (row->overflow[k].dest == dest) {
+            return row->num_base + k;
+        }
+    }
+    return -1;
+}
+
+// returns NULL if there is no edge orig -> dest
+edge_t *adjacency_find_edge(adjacency_t *adj, int orig, int dest) {
+    assert(orig >= 0 && orig < adj->num_rows);
+    int k = adjacency_find_edge_index(adj, orig, dest);
+    return k == -1 ? NULL : adjacency_edge(adj, orig, k);
+}
+
+// same as adjacency_find_edge(adj, orig, dest) != NULL, but scans the parents of dest instead when
+// orig has unsorted edges and dest has fewer in-edges
+bool adjacency_has_edge(adjacency_t *adj, int orig, int dest) {
+    assert(orig >= 0 && orig < adj->num_rows);
+    assert(dest >= 0 && dest < adj->num_rows);
+    adjacency_row_t *row = &adj->rows[dest];
+    if (row->num_parents < adj->rows[orig].num_overflow) {
+        for (int k = 0; k < row->num_parents; k++) {
+            if (row->parents[k] == orig) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return adjacency_find_edge_index(adj, orig, dest) != -1;
+}
+
+// returns the slot of the new (edgeless) vertex, reusing the most recently freed one if there is any
+int adjacency_add_vertex(adjacency_t *adj) {
+    int index;
+    if (adj->num_free_rows) {
+        index = adj->free_rows[--adj->num_free_rows];
+    } else {
+        if (adj->num_rows == adj->rows_capacity) {
+            adj->rows_capacity = adj->rows_capacity ? adj->rows_capacity * 2 : 64;
+            adj->rows = realloc(adj->rows, adj->rows_capacity * sizeof(*adj->rows));
+            assert(adj->rows);
+        }
+        index = adj->num_rows++;
+        adj->rows[index].parents = NULL;
+        adj->rows[index].parents_capacity = 0;
+    }
+    adjacency_row_t *row = &adj->rows[index];
+    row->start = adj->csr_size;
+    row->num_base = 0;
+    row->overflow = NULL;
+    row->num_overflow = 0;
+    row->overflow_capacity = 0;
+    row->num_parents = 0;
+    row->alive = true;
+    adj->num_vertices++;
+    adj->version++;
+    return index;
+}
+
+// makes sure that v can receive `count` more out-edges without reallocating
+// NOTE: grows to exactly what is needed when that is more than doubling the current capacity
+void adjacency_reserve(adjacency_t *adj, int v, int count) {
+    adjacency_row_t *row = &adj->rows[v];
+    int needed = row->num_overflow + count;
+    if (needed > row->overflow_capacity) {
+        int capacity = max(needed, (row->overflow_capacity ? row->overflow_capacity * 2 : 4));
+        row->overflow = realloc(row->overflow, capacity * sizeof(*row->overflow));
+        assert(row->overflow);
+        row->overflow_capacity = capacity;
+    }
+}
+
+// makes sure that v can receive `count` more in-edges without reallocating
+void adjacency_reserve_parents(adjacency_t *adj, int v, int count) {
+    adjacency_row_t *row = &adj->rows[v];
+    int needed = row->num_parents + count;
+    if (needed > row->parents_capacity) {
+        int capacity = max(needed, (row->parents_capacity ? row->parents_capacity * 2 : 4));
+        row->parents = realloc(row->parents, capacity * sizeof(*row->parents));
+        assert(row->parents);
+        row->parents_capacity = capacity;
+    }
+}
+
+void adjacency_add_parent(adjacency_t *adj, int v, int parent) {
+    adjacency_reserve_parents(adj, v, 1);
+    adjacency_row_t *row = &adj->rows[v];
+    row->parents[row->num_parents++] = parent;
+}
+
+void adjacency_remove_parent(adjacency_row_t *row, int parent) {
+    // NOTE: searching backwards makes removing every in-edge of a vertex (newest first) linear
+    for (int i = row->num_parents - 1; i >= 0; i--) {
+        if (row->parents[i] == parent) {
+            row->parents[i] = row->parents[--row->num_parents];
+            return;
+        }
+    }
+    assert(!"parent not found");
+}
+
+int adjacency_compare_edges(const void *a, const void *b) {
+    int dest_a = ((const edge_t *) a)->dest;
+    int dest_b = ((const edge_t *) b)->dest;
+    return (dest_a > dest_b) - (dest_a < dest_b);
+}
+
+// adds the edge without looking for its reverse, for bulk insertions
+// NOTE: the reciprocal flags stay wrong until adjacency_compact() is called, so call it before anything
+// else reads or mutates the edges
+edge_t *adjacency_append_edge(adjacency_t *adj, int orig, int dest, int weight) {
+    assert(adjacency_is_vertex(adj, orig));
+    assert(adjacency_is_vertex(adj, dest));
+    adjacency_add_parent(adj, dest, orig);
+    adjacency_reserve(adj, orig, 1);
+    adjacency_row_t *row = &adj->rows[orig];
+    edge_t *edge = &row->overflow[row->num_overflow++];
+    edge->dest = dest;
+    edge->weight = weight;
+    edge->reciprocal = false;
+    edge->weight_pos_screen = create_v2f(0, 0);
+    adj->num_edges++;
+    adj->version++;
+    return edge;
+}
+
+// NOTE: does not check for duplicates, use adjacency_find_edge first if that matters
+edge_t *adjacency_add_edge(adjacency_t *adj, int orig, int dest, int weight) {
+    assert(adjacency_is_vertex(adj, dest));
+    edge_t *reverse = orig != dest ? adjacency_find_edge(adj, dest, orig) : NULL;
+    if (reverse) {
+        reverse->reciprocal = true;
+    }
+    edge_t *edge = adjacency_append_edge(adj, orig, dest, weight);
+    edge->reciprocal = reverse != NULL;
+    return edge;
+}
+
+// scratch for adjacency_update_reciprocal, one mark per slot (this function allocates the array)
+int *adjacency_reciprocal_marks(adjacency_t *adj) {
+    int *marks = malloc(max(adj->num_rows, 1) * sizeof(*marks));
+    assert(marks);
+    for (int i = 0; i < adj->num_rows; i++) {
+        marks[i] = -1;
+    }
+    return marks;
+}
+
+// recomputes the reciprocal flags of the csr segment of v: v -> dest is reciprocal if dest is also a parent
+// of v, so the parents of v are marked before checking its edges (linear in the number of edges)
+// NOTE: the overflow must be empty
+void adjacency_update_reciprocal(adjacency_t *adj, int v, int *marks) {
+    adjacency_row_t *row = &adj->rows[v];
+    assert(!row->num_overflow);
+    for (int k = 0; k < row->num_parents; k++) {
+        marks[row->parents[k]] = v;
+    }
+    for (int k = 0; k < row->num_base; k++) {
+        edge_t *edge = &adj->csr[row->start + k];
+        edge->reciprocal = edge->dest != v && marks[edge->dest] == v;
+    }
+}
+
+// appends the out-edges of the (edgeless) vertices rows[0 .. num_rows) given as csr arrays: the edges of
+// rows[i] are offsets[i] .. offsets[i + 1] (destinations and reciprocal flags), its parents are
+// parent_offsets[i] .. parent_offsets[i + 1]. destinations and parents index `rows` too. everything is copied
+// into place as it is (the edges go straight to the end of the csr array), so there is nothing to compact or
+// recompute afterwards
+// NOTE: a bulk load (see graph_load_snapshot), the arrays must be valid and consistent (see snapshot_open)
+void adjacency_append_csr(adjacency_t *adj, const int *rows, int num_rows, const uint32_t *offsets,
+                          const int32_t *dests, const int32_t *weights, const uint8_t *reciprocal,
+                          const uint32_t *parent_offsets, const int32_t *parents) {
+    int num_edges = offsets[num_rows];
+    for (int i = 0; i < num_rows; i++) {
+        assert(adjacency_is_vertex(adj, rows[i]) && !adjacency_degree(adj, rows[i]));
+        int num_parents = parent_offsets[i + 1] - parent_offsets[i];
+        adjacency_reserve_parents(adj, rows[i], num_parents);
+        adjacency_row_t *row = &adj->rows[rows[i]];
+        for (int k = 0; k < num_parents; k++) {
+            row->parents[row->num_parents++] = rows[parents[parent_offsets[i] + k]];
+        }
+    }
+
+    edge_t *csr = realloc(adj->csr, max(adj->csr_size + num_edges, 1) * sizeof(*csr));
+    assert(csr);
+    adj->csr = csr;
+    for (int i = 0; i < num_rows; i++) {
+        adjacency_row_t *row = &adj->rows[rows[i]];
+        row->start = adj->csr_size + offsets[i];
+        row->num_base = offsets[i + 1] - offsets[i];
+        edge_t *base = &csr[row->start];
+        bool sorted = true;
+        for (int k = 0; k < row->num_base; k++) {
+            int dest = rows[dests[offsets[i] + k]];
+            base[k].dest = dest;
+            base[k].weight = weights[offsets[i] + k];
+            base[k].reciprocal = reciprocal[offsets[i] + k];
+            base[k].weight_pos_screen = create_v2f(0, 0);
+            sorted = sorted && (k == 0 || base[k - 1].dest <= dest);
+        }
+        // NOTE: reused slots may not come in increasing order (the flags move with their edges)
+        if (!sorted) {
+            qsort(base, row->num_base, sizeof(*base), adjacency_compare_edges);
+        }
+    }
+    adj->csr_size += num_edges;
+    adj->num_edges += num_edges;
+    adj->version++;
+}
+
+// removes the k-th out-edge of v
+// NOTE: the csr segment stays sorted, but the order of the overflow edges is not preserved
+void adjacency_remove_edge_at(adjacency_t *adj, int v, int k) {
+    adjacency_row_t *row = &adj->rows[v];
+    edge_t *edge = adjacency_edge(adj, v, k);
+    if (edge->reciprocal) {
+        edge_t *reverse = adjacency_find_edge(adj, edge->dest, v);
+        assert(reverse);
+        reverse->reciprocal = false;
+    }
+    adjacency_remove_parent(&adj->rows[edge->dest], v);
+    if (k < row->num_base) {
+        edge_t *base = &adj->csr[row->start];
+        memmove(&base[k], &base[k + 1], (row->num_base - k - 1) * sizeof(*base));
+        row->num_base--;
+    } else {
+        row->overflow[k - row->num_base] = row->overflow[row->num_overflow - 1];
+        row->num_overflow--;
+    }
+    adj->num_edges--;
+    adj->version++;
+}
+
+bool adjacency_remove_edge(adjacency_t *adj, int orig, int dest) {
+    int k = adjacency_find_edge_index(adj, orig, dest);
+    if (k == -1) {
+        return false;
+    }
+    adjacency_remove_edge_at(adj, orig, k);
+    return true;
+}
+
+// removes vertex `index` and all of its edges, its slot is freed and no other vertex changes index
+// NOTE: costs O(in-degree + out-degree + sum of the out-degrees of its parents)
+void adjacency_remove_vertex(adjacency_t *adj, int index) {
+    assert(adjacency_is_vertex(adj, index));
+    adjacency_row_t *row = &adj->rows[index];
+
+    while (row->num_parents) {
+        bool removed = adjacency_remove_edge(adj, row->parents[row->num_parents - 1], index);
+        assert(removed);
+    }
+    // NOTE: removing from the end avoids shifting the csr segment
+    for (int k = adjacency_degree(adj, index) - 1; k >= 0; k--) {
+        adjacency_remove_edge_at(adj, index, k);
+    }
+
+    free(row->overflow);
+    row->overflow = NULL;
+    row->overflow_capacity = 0;
+    row->alive = false;
+
+    if (adj->num_free_rows == adj->free_rows_capacity) {
+        adj->free_rows_capacity = adj->free_rows_capacity ? adj->free_rows_capacity * 2 : 64;
+        adj->free_rows = realloc(adj->free_rows, adj->free_rows_capacity * sizeof(*adj->free_rows));
+        assert(adj->free_rows);
+    }
+    adj->free_rows[adj->num_free_rows++] = index;
+    adj->num_vertices--;
+    adj->version++;
+}
+
+// packs every edge (csr segments and overflows) into a new csr array without holes, sorting every
+// segment by destination
+void adjacency_compact(adjacency_t *adj) {
+    edge_t *csr = malloc(max(adj->num_edges, 1) * sizeof(*csr));
+    assert(csr);
+    int size = 0;
+    for (int i = 0; i < adj->num_rows; i++) {
+        adjacency_row_t *row = &adj->rows[i];
+        int start = size;
+        if (row->num_base) {
+            memcpy(&csr[size], &adj->csr[row->start], row->num_base * sizeof(*csr));
+            size += row->num_base;
+        }
+        if (row->num_overflow) {
+            memcpy(&csr[size], row->overflow, row->num_overflow * sizeof(*csr));
+            size += row->num_overflow;
+        }
+
+        if (row->num_overflow) {
+            // NOTE: the csr part is already sorted, but the overflow is usually large after bulk insertions
+            // (which tend to come in order, so the sort is skipped in that case)
+            bool sorted = true;
+            for (int k = start + 1; sorted && k < size; k++) {
+                sorted = csr[k - 1].dest <= csr[k].dest;
+            }
+            if (!sorted) {
+                qsort(&csr[start], size - start, sizeof(*csr), adjacency_compare_edges);
+            }
+        }
+
+        free(row->overflow);
+        row->overflow = NULL;
+        row->num_overflow = 0;
+        row->overflow_capacity = 0;
+        row->start = start;
+        row->num_base = size - start;
+    }
+    assert(size == adj->num_edges);
+    free(adj->csr);
+    adj->csr = csr;
+    adj->csr_size = size;
+
+    int *marks = adjacency_reciprocal_marks(adj);
+    for (int i = 0; i < adj->num_rows; i++) {
+        adjacency_update_reciprocal(adj, i, marks);
+    }
+    free(marks);
+    adj->version++;
+}
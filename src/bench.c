@@ -0,0 +1,162 @@
+// benchmark of the graph engine, runs without a window
+//
+// usage: bench [N] [AVERAGE_DEGREE] [THREADS]
+// generates a random graph with N vertices and times the operations the viewer relies on, BFS is also
+// timed on THREADS threads (and checked against the single threaded result)
+
+#include "graph.h"
+
+#define BENCH_EXPORT_FILENAME "bench.txt"
+#define BENCH_SNAPSHOT_FILENAME "bench.snapshot"
+
+void bench_report(const char *name, double start) {
+    printf("%-16s %10.3f ms\n", name, (wall_clock() - start) * 1000);
+}
+
+// returns true if `loaded` holds the same vertices (in slot order, free slots skipped) and edges as `graph`
+// NOTE: text exports store positions as multiples of 1/4, so `quantized` compares them rounded that way. every
+// graph is compacted at this point, so the out-edges of a vertex are sorted by destination in both
+bool bench_same_graph(graph_t *graph, graph_t *loaded, bool quantized) {
+    adjacency_t *adj = &graph->adjacency;
+    adjacency_t *loaded_adj = &loaded->adjacency;
+    if (adj->num_vertices != loaded_adj->num_vertices || adj->num_edges != loaded_adj->num_edges ||
+        loaded->num_circles != adj->num_vertices) {
+        return false;
+    }
+    int *ids = malloc(max(graph->num_circles, 1) * sizeof(*ids));
+    assert(ids);
+    int num_ids = 0;
+    for (int i = 0; i < graph->num_circles; i++) {
+        ids[i] = adjacency_is_vertex(adj, i) ? num_ids++ : -1;
+    }
+    bool same = true;
+    for (int i = 0; same && i < graph->num_circles; i++) {
+        if (ids[i] == -1) {
+            continue;
+        }
+        v2f p = graph->positions[i];
+        if (quantized) {
+            p = create_v2f((int) (p.x * 4) / 4.0, (int) (p.y * 4) / 4.0);
+        }
+        v2f q = loaded->positions[ids[i]];
+        same = p.x == q.x && p.y == q.y && adjacency_degree(adj, i) == adjacency_degree(loaded_adj, ids[i]);
+        for (int k = 0; same && k < adjacency_degree(adj, i); k++) {
+            edge_t *edge = adjacency_edge(adj, i, k);
+            edge_t *loaded_edge = adjacency_edge(loaded_adj, ids[i], k);
+            same = ids[edge->dest] == loaded_edge->dest && edge->weight == loaded_edge->weight;
+        }
+    }
+    free(ids);
+    return same;
+}
+
+int main(int argc, char **argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    double average_degree = argc > 2 ? atof(argv[2]) : 8;
+    int num_threads = argc > 3 ? atoi(argv[3]) : 4;
+    if (n <= 1 || average_degree < 0 || num_threads < 1) {
+        fprintf(stderr, "Usage: %s [N] [AVERAGE_DEGREE] [THREADS]\n", argv[0]);
+        return -1;
+    }
+    srand(0);
+
+    graph_t graph;
+    graph_init(&graph);
+    double start = wall_clock();
+    graph_generate_random(&graph, n, min(average_degree / (n - 1), 1.0), create_v2f(0, 0));
+    bench_report("generate", start);
+
+    start = wall_clock();
+    graph_bfs(&graph, 0);
+    bench_report("bfs", start);
+    start = wall_clock();
+    graph_bfs(&graph, 0);
+    bench_report("bfs (warm)", start);
+
+    int *levels = malloc(graph.num_circles * sizeof(*levels));
+    int *parents = malloc(graph.num_circles * sizeof(*parents));
+    assert(levels && parents);
+    memcpy(levels, graph.bfs.levels, graph.num_circles * sizeof(*levels));
+    memcpy(parents, graph.bfs.parents, graph.num_circles * sizeof(*parents));
+    bfs_set_threads(&graph.bfs, num_threads);
+    graph_bfs(&graph, 0);
+    start = wall_clock();
+    graph_bfs(&graph, 0);
+    printf("%-16s %10.3f ms (%d threads)\n", "bfs (parallel)", (wall_clock() - start) * 1000, graph.bfs.num_threads);
+    if (memcmp(levels, graph.bfs.levels, graph.num_circles * sizeof(*levels)) ||
+        memcmp(parents, graph.bfs.parents, graph.num_circles * sizeof(*parents))) {
+        fprintf(stderr, "The parallel BFS doesn't match the serial one\n");
+        return -1;
+    }
+    free(levels);
+    free(parents);
+    bfs_set_threads(&graph.bfs, 1);
+    start = wall_clock();
+    graph_flood(&graph, 0);
+    bench_report("flood", start);
+
+    // NOTE: 1000 picks around the vertices, roughly what a second of dragging the cursor does
+    start = wall_clock();
+    int picked = 0;
+    for (int i = 0; i < 1000; i++) {
+        v2f p = graph.positions[(int) ((long long) i * n / 1000)];
+        picked += grid_find_nearest(&graph.vertex_grid, add_v2f(p, create_v2f(0.5, 0.5)), 1.0) != -1;
+    }
+    printf("%-16s %10.3f ms (%d hits)\n", "pick (x1000)", (wall_clock() - start) * 1000, picked);
+
+    int *selection = malloc(graph.num_circles * sizeof(*selection));
+    assert(selection);
+    v2f low = graph.positions[0], high = graph.positions[0];
+    for (int i = 1; i < n; i++) {
+        low = create_v2f(min(low.x, graph.positions[i].x), min(low.y, graph.positions[i].y));
+        high = create_v2f(max(high.x, graph.positions[i].x), max(high.y, graph.positions[i].y));
+    }
+    start = wall_clock();
+    int num_selected = graph_vertices_in_rect(&graph, low, add_v2f(low, scale_v2f(sub_v2f(high, low), 0.5)), selection);
+    printf("%-16s %10.3f ms (%d vertices)\n", "box select", (wall_clock() - start) * 1000, num_selected);
+    free(selection);
+
+    // NOTE: removes every edge of a few vertices so the next compaction has holes to close
+    for (int i = 0; i < n; i += 100) {
+        while (adjacency_degree(&graph.adjacency, i)) {
+            adjacency_remove_edge_at(&graph.adjacency, i, 0);
+        }
+    }
+    start = wall_clock();
+    adjacency_compact(&graph.adjacency);
+    bench_report("compact", start);
+
+    start = wall_clock();
+    export_job_finish(graph_export(&graph, BENCH_EXPORT_FILENAME));
+    bench_report("export", start);
+
+    start = wall_clock();
+    graph_save_snapshot(&graph, BENCH_SNAPSHOT_FILENAME, NULL);
+    bench_report("save snapshot", start);
+
+    graph_t loaded;
+    graph_init(&loaded);
+    start = wall_clock();
+    bool ok = graph_load(&loaded, BENCH_EXPORT_FILENAME);
+    bench_report("load", start);
+    if (!ok || !bench_same_graph(&graph, &loaded, true)) {
+        fprintf(stderr, "The loaded export doesn't match the graph\n");
+        return -1;
+    }
+    graph_destroy(&loaded);
+
+    graph_init(&loaded);
+    start = wall_clock();
+    ok = graph_load_snapshot(&loaded, BENCH_SNAPSHOT_FILENAME, NULL);
+    bench_report("load snapshot", start);
+    if (!ok || !bench_same_graph(&graph, &loaded, false)) {
+        fprintf(stderr, "The loaded snapshot doesn't match the graph\n");
+        return -1;
+    }
+    graph_destroy(&loaded);
+
+    graph_destroy(&graph);
+    remove(BENCH_EXPORT_FILENAME);
+    remove(BENCH_SNAPSHOT_FILENAME);
+    return 0;
+}
@@ -0,0 +1,541 @@
+// direction-optimizing breadth-first search over the adjacency store
+//
+// every level is expanded either top-down (the frontier pushes along its out-edges) or bottom-up (every
+// unreached vertex looks for a parent in the frontier along its in-edges, stopping at the first one). the
+// bottom-up step pays off once the frontier has more edges than the part of the graph not reached yet,
+// and switching back once the frontier shrinks keeps the tail of the traversal cheap.
+//
+// big levels can be expanded by several threads (see bfs_set_threads). the threads are started once and
+// wait for work between the phases of every step. the work is split in chunks that the threads claim one
+// at a time, every thread keeps what it reached in its own buffer and the buffers
+// are concatenated in chunk order, so levels, parents and the discovery order are the same as with a
+// single thread.
+// NOTE: the types are declared in graph.h
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+// switch to bottom-up when the frontier has more than 1 / BFS_ALPHA of the unexplored edges, and back to
+// top-down when it has less than 1 / BFS_BETA of the vertices
+#define BFS_ALPHA 14
+#define BFS_BETA 24
+
+// NOTE: smaller graphs are always expanded top-down, scanning every vertex for each level doesn't pay off
+// for them and this keeps their discovery order (and so the flood animation) the same as a queue BFS
+#define BFS_BOTTOM_UP_MIN_VERTICES 4096
+
+// levels with fewer edges than this are expanded by the calling thread alone (waking the threads costs more)
+#define BFS_PARALLEL_MIN_EDGES (1 << 14)
+#define BFS_TOP_DOWN_CHUNK 256 // frontier vertices
+#define BFS_BOTTOM_UP_CHUNK 4096 // vertex slots
+
+#define BFS_BIT_SET(bits, i) ((bits)[(i) >> 6] |= (uint64_t) 1 << ((i) & 63))
+#define BFS_BIT_TEST(bits, i) (((bits)[(i) >> 6] >> ((i) & 63)) & 1)
+
+// what the threads work on during a parallel step
+typedef enum {
+    BFS_CLAIM, // top-down, every unreached child keeps the smallest key of the edges that reach it
+    BFS_EMIT, // top-down, the edge holding the key of its child reaches it
+    BFS_BOTTOM_UP,
+} bfs_phase_t;
+
+typedef struct {
+    bfs_t *bfs;
+    adjacency_t *adj;
+    bfs_phase_t phase;
+    int start, end; // frontier inside bfs->order
+    int level;
+    int num_chunks;
+    volatile long next_chunk;
+} bfs_step_t;
+
+typedef struct {
+    bfs_pool_t *pool;
+    int thread;
+} bfs_worker_t;
+
+// threads that wait for the phases handed to them by bfs_run_phase
+struct bfs_pool_t {
+    int num_workers; // NOTE: can be less than num_threads - 1 if some threads could not be started
+    bfs_worker_t workers[BFS_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE threads[BFS_MAX_THREADS];
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE work_ready;
+    CONDITION_VARIABLE work_done;
+#else
+    pthread_t threads[BFS_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+#endif
+    bfs_step_t *step; // NOTE: the phase to run is inside the step
+    int generation; // bumped for every phase, lets the workers tell a new phase from a spurious wakeup
+    int num_busy; // workers still running the current phase
+    bool quit;
+};
+
+void bfs_pool_destroy(bfs_pool_t *pool);
+bfs_pool_t *bfs_pool_create(int num_workers);
+
+void bfs_init(bfs_t *bfs) {
+    memset(bfs, 0, sizeof(*bfs));
+    bfs->root = -1;
+    bfs->num_threads = 1;
+}
+
+void bfs_destroy(bfs_t *bfs) {
+    free(bfs->levels);
+    free(bfs->parents);
+    free(bfs->order);
+    free(bfs->frontier_bits);
+    free(bfs->visited_bits);
+    free(bfs->keys);
+    free(bfs->chunks);
+    for (int i = 0; i < BFS_MAX_THREADS; i++) {
+        free(bfs->threads[i].found);
+    }
+    if (bfs->pool) {
+        bfs_pool_destroy(bfs->pool);
+    }
+    bfs_init(bfs);
+}
+
+// sets how many threads expand the big levels (1 means only the calling thread), the other threads are
+// started here and kept until the next call (or bfs_destroy)
+void bfs_set_threads(bfs_t *bfs, int num_threads) {
+    num_threads = min(max(num_threads, 1), BFS_MAX_THREADS);
+    if (bfs->pool && num_threads == bfs->num_threads) {
+        return;
+    }
+    if (bfs->pool) {
+        bfs_pool_destroy(bfs->pool);
+        bfs->pool = NULL;
+    }
+    bfs->num_threads = num_threads;
+    if (num_threads > 1) {
+        bfs->pool = bfs_pool_create(num_threads - 1);
+    }
+}
+
+// makes room for `num_rows` vertex slots, the buffers only grow so they are reused between traversals
+void bfs_reserve(bfs_t *bfs, int num_rows) {
+    if (num_rows <= bfs->capacity) {
+        return;
+    }
+    bfs->capacity = max(num_rows, bfs->capacity * 2);
+    bfs->levels = realloc(bfs->levels, bfs->capacity * sizeof(*bfs->levels));
+    bfs->parents = realloc(bfs->parents, bfs->capacity * sizeof(*bfs->parents));
+    bfs->order = realloc(bfs->order, bfs->capacity * sizeof(*bfs->order));
+    bfs->frontier_bits = realloc(bfs->frontier_bits, BFS_BITMAP_WORDS(bfs->capacity) * sizeof(*bfs->frontier_bits));
+    bfs->visited_bits = realloc(bfs->visited_bits, BFS_BITMAP_WORDS(bfs->capacity) * sizeof(*bfs->visited_bits));
+    bfs->keys = realloc(bfs->keys, bfs->capacity * sizeof(*bfs->keys));
+    bfs->chunks = realloc(bfs->chunks, (bfs->capacity / min(BFS_TOP_DOWN_CHUNK, BFS_BOTTOM_UP_CHUNK) + 1) * sizeof(*bfs->chunks));
+    assert(bfs->levels && bfs->parents && bfs->order && bfs->frontier_bits && bfs->visited_bits && bfs->keys && bfs->chunks);
+}
+
+// marks `v` as reached at `level` from `parent` and appends it to `out`
+static inline void bfs_reach(bfs_t *bfs, int v, int parent, int level, int *out, int *num_out) {
+    bfs->levels[v] = level;
+    bfs->parents[v] = parent;
+    out[(*num_out)++] = v;
+}
+
+// expands the frontier order[start .. end) along its out-edges, returns the number of out-edges of the
+// vertices it reached
+int64_t bfs_top_down_step(bfs_t *bfs, adjacency_t *adj, int start, int end, int level) {
+    int64_t next_edges = 0;
+    for (int i = start; i < end; i++) {
+        int node = bfs->order[i];
+        adjacency_row_t *row = &adj->rows[node];
+        for (int k = 0; k < row->num_base + row->num_overflow; k++) {
+            int child = k < row->num_base ? adj->csr[row->start + k].dest : row->overflow[k - row->num_base].dest;
+            if (!BFS_BIT_TEST(bfs->visited_bits, child)) {
+                BFS_BIT_SET(bfs->visited_bits, child);
+                bfs_reach(bfs, child, node, level, bfs->order, &bfs->num_reached);
+                next_edges += adj->rows[child].num_base + adj->rows[child].num_overflow;
+            }
+        }
+    }
+    return next_edges;
+}
+
+// fills the frontier bitmap with order[start .. end)
+void bfs_mark_frontier(bfs_t *bfs, adjacency_t *adj, int start, int end) {
+    memset(bfs->frontier_bits, 0, BFS_BITMAP_WORDS(adj->num_rows) * sizeof(*bfs->frontier_bits));
+    for (int i = start; i < end; i++) {
+        BFS_BIT_SET(bfs->frontier_bits, bfs->order[i]);
+    }
+}
+
+// lets the unreached vertices in first .. last - 1 look for a parent inside the frontier bitmap, the ones
+// that find it are appended to `out`, returns the number of out-edges of the vertices it reached
+// NOTE: doesn't touch the visited bitmap, so several threads can run it on different ranges
+int64_t bfs_bottom_up_range(bfs_t *bfs, adjacency_t *adj, int first, int last, int level, int *out, int *num_out) {
+    int64_t next_edges = 0;
+    for (int v = first; v < last; v++) {
+        if (BFS_BIT_TEST(bfs->visited_bits, v)) {
+            continue;
+        }
+        // NOTE: free slots have no parents, so they are never reached
+        adjacency_row_t *row = &adj->rows[v];
+        for (int k = 0; k < row->num_parents; k++) {
+            int parent = row->parents[k];
+            if (BFS_BIT_TEST(bfs->frontier_bits, parent)) {
+                bfs_reach(bfs, v, parent, level, out, num_out);
+                next_edges += row->num_base + row->num_overflow;
+                break;
+            }
+        }
+    }
+    return next_edges;
+}
+
+// lets every unreached vertex look for a parent inside the frontier order[start .. end), returns the
+// number of out-edges of the vertices it reached
+int64_t bfs_bottom_up_step(bfs_t *bfs, adjacency_t *adj, int start, int end, int level) {
+    bfs_mark_frontier(bfs, adj, start, end);
+    int first = bfs->num_reached;
+    int64_t next_edges = bfs_bottom_up_range(bfs, adj, 0, adj->num_rows, level, bfs->order, &bfs->num_reached);
+    for (int i = first; i < bfs->num_reached; i++) {
+        BFS_BIT_SET(bfs->visited_bits, bfs->order[i]);
+    }
+    return next_edges;
+}
+
+// lowers *p to `value` if it is smaller, atomically
+static inline void bfs_atomic_min(volatile int64_t *p, int64_t value) {
+    int64_t current = *p;
+    while (value < current) {
+#ifdef _WIN32
+        int64_t seen = InterlockedCompareExchange64((volatile LONG64 *) p, value, current);
+        if (seen == current) {
+            return;
+        }
+        current = seen;
+#else
+        if (__atomic_compare_exchange_n(p, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+#endif
+    }
+}
+
+static inline int bfs_claim_chunk(bfs_step_t *step) {
+#ifdef _WIN32
+    return InterlockedExchangeAdd(&step->next_chunk, 1);
+#else
+    return __atomic_fetch_add(&step->next_chunk, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+// makes room for `count` more vertices in the buffer of a thread
+void bfs_thread_reserve(bfs_thread_t *local, int count) {
+    if (local->num_found + count > local->found_capacity) {
+        local->found_capacity = max(local->num_found + count, local->found_capacity * 2);
+        local->found = realloc(local->found, local->found_capacity * sizeof(*local->found));
+        assert(local->found);
+    }
+}
+
+// claims chunks of the step until there are none left
+void bfs_work(bfs_step_t *step, int thread) {
+    bfs_t *bfs = step->bfs;
+    adjacency_t *adj = step->adj;
+    bfs_thread_t *local = &bfs->threads[thread];
+    for (int chunk = bfs_claim_chunk(step); chunk < step->num_chunks; chunk = bfs_claim_chunk(step)) {
+        bfs->chunks[chunk].thread = thread;
+        bfs->chunks[chunk].start = local->num_found;
+
+        if (step->phase == BFS_BOTTOM_UP) {
+            int first = chunk * BFS_BOTTOM_UP_CHUNK;
+            int last = min(first + BFS_BOTTOM_UP_CHUNK, adj->num_rows);
+            bfs_thread_reserve(local, last - first);
+            local->next_edges += bfs_bottom_up_range(bfs, adj, first, last, step->level, local->found, &local->num_found);
+        } else {
+            int first = step->start + chunk * BFS_TOP_DOWN_CHUNK;
+            int last = min(first + BFS_TOP_DOWN_CHUNK, step->end);
+            for (int i = first; i < last; i++) {
+                int node = bfs->order[i];
+                adjacency_row_t *row = &adj->rows[node];
+                for (int k = 0; k < row->num_base + row->num_overflow; k++) {
+                    int child = k < row->num_base ? adj->csr[row->start + k].dest : row->overflow[k - row->num_base].dest;
+                    if (BFS_BIT_TEST(bfs->visited_bits, child)) {
+                        continue;
+                    }
+                    // NOTE: the key orders edges the way the serial step visits them, so the child ends up
+                    // with the parent (and the position) it would get from it
+                    int64_t key = (int64_t) i << 32 | k;
+                    if (step->phase == BFS_CLAIM) {
+                        bfs_atomic_min(&bfs->keys[child], key);
+                    } else if (bfs->keys[child] == key) {
+                        bfs_thread_reserve(local, 1);
+                        bfs_reach(bfs, child, node, step->level, local->found, &local->num_found);
+                        local->next_edges += adj->rows[child].num_base + adj->rows[child].num_overflow;
+                    }
+                }
+            }
+        }
+        bfs->chunks[chunk].count = local->num_found - bfs->chunks[chunk].start;
+    }
+}
+
+// waits for phases until the pool is destroyed
+void bfs_worker_loop(bfs_worker_t *worker) {
+    bfs_pool_t *pool = worker->pool;
+    int generation = 0;
+#ifdef _WIN32
+    EnterCriticalSection(&pool->lock);
+    for (;;) {
+        while (pool->generation == generation && !pool->quit) {
+            SleepConditionVariableCS(&pool->work_ready, &pool->lock, INFINITE);
+        }
+        if (pool->quit) {
+            break;
+        }
+        generation = pool->generation;
+        bfs_step_t *step = pool->step;
+        LeaveCriticalSection(&pool->lock);
+        bfs_work(step, worker->thread);
+        EnterCriticalSection(&pool->lock);
+        if (--pool->num_busy == 0) {
+            WakeConditionVariable(&pool->work_done);
+        }
+    }
+    LeaveCriticalSection(&pool->lock);
+#else
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == generation && !pool->quit) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+        generation = pool->generation;
+        bfs_step_t *step = pool->step;
+        pthread_mutex_unlock(&pool->lock);
+        bfs_work(step, worker->thread);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->num_busy == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
+#ifdef _WIN32
+DWORD WINAPI bfs_thread(LPVOID data) {
+    bfs_worker_loop(data);
+    return 0;
+}
+#else
+void *bfs_thread(void *data) {
+    bfs_worker_loop(data);
+    return NULL;
+}
+#endif
+
+// starts `num_workers` threads that wait for phases, worker i expands with the buffer of thread i + 1
+// NOTE: if a thread can't be started the pool just has fewer of them, the others claim its chunks
+bfs_pool_t *bfs_pool_create(int num_workers) {
+    bfs_pool_t *pool = calloc(1, sizeof(*pool));
+    assert(pool);
+#ifdef _WIN32
+    InitializeCriticalSection(&pool->lock);
+    InitializeConditionVariable(&pool->work_ready);
+    InitializeConditionVariable(&pool->work_done);
+#else
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+#endif
+    for (int i = 0; i < num_workers; i++) {
+        bfs_worker_t *worker = &pool->workers[pool->num_workers];
+        worker->pool = pool;
+        worker->thread = pool->num_workers + 1;
+#ifdef _WIN32
+        pool->threads[pool->num_workers] = CreateThread(NULL, 0, bfs_thread, worker, 0, NULL);
+        bool started = pool->threads[pool->num_workers] != NULL;
+#else
+        bool started = !pthread_create(&pool->threads[pool->num_workers], NULL, bfs_thread, worker);
+#endif
+        pool->num_workers += started;
+    }
+    return pool;
+}
+
+// stops the threads of the pool, waits for them and frees it
+void bfs_pool_destroy(bfs_pool_t *pool) {
+#ifdef _WIN32
+    EnterCriticalSection(&pool->lock);
+    pool->quit = true;
+    WakeAllConditionVariable(&pool->work_ready);
+    LeaveCriticalSection(&pool->lock);
+    for (int i = 0; i < pool->num_workers; i++) {
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+    }
+    DeleteCriticalSection(&pool->lock);
+#else
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+#endif
+    free(pool);
+}
+
+// runs a phase of a step on every thread of the pool and the calling one, and waits for all of them
+// NOTE: the lock hands the step to the workers and their results back, so nothing else is needed to see
+// what they wrote
+void bfs_run_phase(bfs_step_t *step, bfs_phase_t phase, int num_chunks) {
+    bfs_t *bfs = step->bfs;
+    bfs_pool_t *pool = bfs->pool;
+    step->phase = phase;
+    step->num_chunks = num_chunks;
+    step->next_chunk = 0;
+    for (int i = 0; i < bfs->num_threads; i++) {
+        bfs->threads[i].num_found = 0;
+        bfs->threads[i].next_edges = 0;
+    }
+    if (!pool || !pool->num_workers) {
+        bfs_work(step, 0);
+        return;
+    }
+
+#ifdef _WIN32
+    EnterCriticalSection(&pool->lock);
+    pool->step = step;
+    pool->num_busy = pool->num_workers;
+    pool->generation++;
+    WakeAllConditionVariable(&pool->work_ready);
+    LeaveCriticalSection(&pool->lock);
+    bfs_work(step, 0);
+    EnterCriticalSection(&pool->lock);
+    while (pool->num_busy) {
+        SleepConditionVariableCS(&pool->work_done, &pool->lock, INFINITE);
+    }
+    LeaveCriticalSection(&pool->lock);
+#else
+    pthread_mutex_lock(&pool->lock);
+    pool->step = step;
+    pool->num_busy = pool->num_workers;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    bfs_work(step, 0);
+    pthread_mutex_lock(&pool->lock);
+    while (pool->num_busy) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
+// appends what the threads reached to the discovery order (in chunk order) and marks it as visited,
+// returns the number of out-edges of those vertices
+int64_t bfs_merge(bfs_t *bfs, int num_chunks) {
+    for (int chunk = 0; chunk < num_chunks; chunk++) {
+        bfs_chunk_t *c = &bfs->chunks[chunk];
+        int *found = &bfs->threads[c->thread].found[c->start];
+        for (int i = 0; i < c->count; i++) {
+            BFS_BIT_SET(bfs->visited_bits, found[i]);
+            bfs->order[bfs->num_reached++] = found[i];
+        }
+    }
+    int64_t next_edges = 0;
+    for (int i = 0; i < bfs->num_threads; i++) {
+        next_edges += bfs->threads[i].next_edges;
+    }
+    return next_edges;
+}
+
+// same as the serial steps, spread over the threads
+int64_t bfs_parallel_step(bfs_t *bfs, adjacency_t *adj, int start, int end, int level, bool bottom_up) {
+    bfs_step_t step = {0};
+    step.bfs = bfs;
+    step.adj = adj;
+    step.start = start;
+    step.end = end;
+    step.level = level;
+
+    int num_chunks;
+    if (bottom_up) {
+        bfs_mark_frontier(bfs, adj, start, end);
+        num_chunks = (adj->num_rows + BFS_BOTTOM_UP_CHUNK - 1) / BFS_BOTTOM_UP_CHUNK;
+        bfs_run_phase(&step, BFS_BOTTOM_UP, num_chunks);
+    } else {
+        num_chunks = (end - start + BFS_TOP_DOWN_CHUNK - 1) / BFS_TOP_DOWN_CHUNK;
+        bfs_run_phase(&step, BFS_CLAIM, num_chunks);
+        bfs_run_phase(&step, BFS_EMIT, num_chunks);
+    }
+    return bfs_merge(bfs, num_chunks);
+}
+
+// traverses `adj` from `root`, the results stay in `bfs` until the next traversal
+void bfs_run(bfs_t *bfs, adjacency_t *adj, int root) {
+    assert(adjacency_is_vertex(adj, root));
+    bfs_reserve(bfs, adj->num_rows);
+    for (int i = 0; i < adj->num_rows; i++) {
+        bfs->levels[i] = -1;
+        bfs->parents[i] = -1;
+    }
+    memset(bfs->visited_bits, 0, BFS_BITMAP_WORDS(adj->num_rows) * sizeof(*bfs->visited_bits));
+    if (bfs->num_threads > 1) {
+        for (int i = 0; i < adj->num_rows; i++) {
+            bfs->keys[i] = INT64_MAX;
+        }
+    }
+    bfs->root = root;
+    bfs->depth = 0;
+    bfs->num_bottom_up_levels = 0;
+    bfs->levels[root] = 0;
+    bfs->order[0] = root;
+    bfs->num_reached = 1;
+    BFS_BIT_SET(bfs->visited_bits, root);
+
+    bool can_go_bottom_up = adj->num_vertices >= BFS_BOTTOM_UP_MIN_VERTICES;
+    bool bottom_up = false;
+    int64_t frontier_edges = adjacency_degree(adj, root);
+    int64_t unexplored_edges = adj->num_edges - frontier_edges;
+    int start = 0;
+    int end = 1;
+    while (start < end) {
+        int frontier_size = end - start;
+        if (!bottom_up) {
+            bottom_up = can_go_bottom_up && frontier_edges > unexplored_edges / BFS_ALPHA;
+        } else {
+            bottom_up = frontier_size >= adj->num_vertices / BFS_BETA;
+        }
+
+        int level = bfs->depth + 1;
+        // NOTE: a bottom-up level looks at (almost) every edge, so it is always worth spreading
+        bool parallel = bfs->num_threads > 1 && (bottom_up || frontier_edges >= BFS_PARALLEL_MIN_EDGES);
+        if (parallel) {
+            frontier_edges = bfs_parallel_step(bfs, adj, start, end, level, bottom_up);
+        } else if (bottom_up) {
+            frontier_edges = bfs_bottom_up_step(bfs, adj, start, end, level);
+        } else {
+            frontier_edges = bfs_top_down_step(bfs, adj, start, end, level);
+        }
+        bfs->num_bottom_up_levels += bottom_up;
+        unexplored_edges -= frontier_edges;
+        start = end;
+        end = bfs->num_reached;
+        if (start < end) {
+            bfs->depth = level;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#version 330
+
+// NOTE: every fragment looks at this many entrances on each side of it (per start time), so its cost doesn't
+// grow with the number of entrances
+#define NEAREST_ENTRANCES 2
+
+uniform float time; // seconds since the flood animation started
+uniform vec3 filled_color;
+uniform samplerBuffer flood_entrances; // direction towards the father, start time and angle of every entrance
+
+in vec3 color;
+in vec2 local_position;
+flat in int first_entrance;
+flat in int num_entrances;
+flat in int num_first_entrances;
+flat in float fill_end;
+
+layout(location = 0) out vec4 frag_color;
+
+// TODO: maybe pass this as an uniform?
+const vec3 vertex_default_color = vec3(0.8, 0.8, 0.8);
+const float delta = 0.18; // TODO: change this to a constant or something
+
+vec3 fill_entrance(vec4 entrance, vec3 final_color) {
+    float fill_radius = max(time - entrance.z, 0.0);
+    float dist = distance(entrance.xy, local_position);
+    float lerp_aux = smoothstep(fill_radius - delta, fill_radius + delta, dist);
+    vec3 temp_color = mix(filled_color, vertex_default_color, lerp_aux);
+    vec3 color_offset = abs(vertex_default_color - temp_color);
+    return clamp(final_color - color_offset, filled_color, vertex_default_color);
+}
+
+// first entrance of each group (counted from the start of the group) with an angle >= the angle of the
+// fragment, the two groups are searched in the same loop
+ivec2 search_entrances(ivec2 first, ivec2 count) {
+    float angle = atan(local_position.y, local_position.x);
+    ivec2 low = ivec2(0);
+    ivec2 high = count;
+    while (any(lessThan(low, high))) {
+        ivec2 middle = (low + high) / 2;
+        if (low.x < high.x) {
+            if (texelFetch(flood_entrances, first.x + middle.x).w < angle) {
+                low.x = middle.x + 1;
+            } else {
+                high.x = middle.x;
+            }
+        }
+        if (low.y < high.y) {
+            if (texelFetch(flood_entrances, first.y + middle.y).w < angle) {
+                low.y = middle.y + 1;
+            } else {
+                high.y = middle.y;
+            }
+        }
+    }
+    return low;
+}
+
+void main() {
+    if (num_entrances == 0) {
+        frag_color = vec4(color, 1.0);
+        return;
+    }
+    if (time >= fill_end) {
+        frag_color = vec4(filled_color, 1.0);
+        return;
+    }
+
+    // the entrances of a vertex come from the previous level or from its own one, so they make at most two
+    // groups with the same start time, each sorted by angle
+    // NOTE: the entrances are on the border of the circle, so the ones closest to the fragment are the ones
+    // closest in angle, the others are covered by them
+    ivec2 first = ivec2(first_entrance, first_entrance + num_first_entrances);
+    ivec2 count = ivec2(num_first_entrances, num_entrances - num_first_entrances);
+    ivec2 begin = ivec2(0);
+    if (any(greaterThan(count, ivec2(2 * NEAREST_ENTRANCES)))) {
+        // NOTE: NEAREST_ENTRANCES whole turns are added so begin never goes negative (GLSL leaves % of a
+        // negative number undefined), a group with a single entrance would get -1 otherwise
+        begin = max(search_entrances(first, count) - NEAREST_ENTRANCES + NEAREST_ENTRANCES * count, ivec2(0));
+    }
+    ivec2 num_nearest = min(count, ivec2(2 * NEAREST_ENTRANCES));
+
+    vec3 final_color = vertex_default_color;
+    for (int i = 0; i < num_nearest.x + num_nearest.y; i++) {
+        int group = i < num_nearest.x ? 0 : 1;
+        int k = (begin[group] + i - group * num_nearest.x) % count[group];
+        final_color = fill_entrance(texelFetch(flood_entrances, first[group] + k), final_color);
+    }
+    frag_color = vec4(final_color, 1.0);
+}
@@ -0,0 +1,41 @@
+#version 330
+
+uniform vec2 translation;
+uniform float scale;
+uniform float aspect_ratio;
+uniform bool flooding; // NOTE: false while there is no flood animation (flood_vertices is not read then)
+uniform isamplerBuffer flood_vertices; // first entrance, number of entrances, number of them with the earliest start
+                                       // and end time (bits) of every vertex
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 instance_position;
+layout(location = 2) in vec3 instance_color;
+layout(location = 3) in int instance_vertex;
+
+out vec3 color;
+out vec2 local_position; // NOTE: relative to the center of the circle
+flat out int first_entrance;
+flat out int num_entrances;
+flat out int num_first_entrances;
+flat out float fill_end;
+
+void main() {
+    vec3 temp = vec3(translation + instance_position, 0) + position;
+    vec3 pos = scale * temp;
+    vec3 screen_pos = vec3(pos.x, pos.y * aspect_ratio, pos.z);
+    gl_Position = vec4(screen_pos, 1.0);
+
+    color = instance_color;
+    local_position = position.xy;
+    first_entrance = 0;
+    num_entrances = 0;
+    num_first_entrances = 0;
+    fill_end = 0;
+    if (flooding) {
+        ivec4 flood = texelFetch(flood_vertices, instance_vertex);
+        first_entrance = flood.x;
+        num_entrances = flood.y;
+        num_first_entrances = flood.z;
+        fill_end = intBitsToFloat(flood.w);
+    }
+}
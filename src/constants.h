@@ -5,10 +5,9 @@
 #define NUM_SECTIONS_CIRCLE 60
 #define LINE_WIDTH 2.4f
 
-#define MAX_VERTICES 20000
-#define MAX_VERTEX_ENTRANCES 100
-
 #define ARROW_HEAD_CONSTANT 0.038f
+#define EDGE_CURVE_SEGMENTS 20
+#define EDGE_CULL_REACH 8.0f
 
 #define BACKGROUND_COLOR 0.75f, 0.5f, 0.3f
 #define VERTEX_DEFAULT_COLOR 0.8f, 0.8f, 0.8f
@@ -21,3 +20,6 @@
 #define WEIGHT_RANDOM_LIMIT 100
 
 #define FONT_SIZE 20
+
+#define STREAM_BUFFER_SIZE (4 * 1024 * 1024)
+#define STREAM_MAX_FRAMES 3
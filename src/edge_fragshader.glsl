@@ -0,0 +1,13 @@
+#version 330
+
+uniform vec3 filled_color;
+
+in vec3 color;
+in float progress;
+flat in float front;
+
+layout(location = 0) out vec4 frag_color;
+
+void main() {
+    frag_color = vec4(progress <= front ? filled_color : color, 1.0);
+}
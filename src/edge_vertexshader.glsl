@@ -0,0 +1,35 @@
+#version 330
+
+uniform vec2 translation;
+uniform float scale;
+uniform float aspect_ratio;
+uniform bool flooding; // NOTE: false while there is no flood animation (flood_edges is not read then)
+uniform float time; // seconds since the flood animation started
+uniform samplerBuffer flood_edges; // time the flood starts and ends running along every edge (-1 if it never does)
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 offset; // NOTE: in screen units, used by the arrow heads so they don't scale with zoom
+layout(location = 2) in vec3 vertex_color;
+layout(location = 3) in float vertex_progress;
+layout(location = 4) in int edge;
+
+out vec3 color;
+out float progress;
+flat out float front; // how far along the edge the flood got, -1 if it didn't start
+
+void main() {
+    vec3 temp = vec3(translation + position + offset / scale, 0.2);
+    vec3 pos = scale * temp;
+    vec3 screen_pos = vec3(pos.x, pos.y * aspect_ratio, pos.z);
+    gl_Position = vec4(screen_pos, 1.0);
+
+    color = vertex_color;
+    progress = vertex_progress;
+    front = -1;
+    if (flooding && edge != -1) {
+        vec2 flood = texelFetch(flood_edges, edge).xy;
+        if (flood.x >= 0 && time >= flood.x) {
+            front = (time - flood.x) / (flood.y - flood.x);
+        }
+    }
+}
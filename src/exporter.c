@@ -0,0 +1,207 @@
+// background exporter for the text format
+//
+// the ui thread copies the graph into an export_job_t (which is cheap compared to formatting it) and a
+// worker thread formats it into large buffers and writes them, so exporting never stalls rendering.
+//
+// format:
+//     num_vertices num_edges
+//     id x y weight (once per vertex, positions are multiplied by 4)
+//     orig dest weight (once per edge)
+//     root
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+#include <time.h>
+
+#define EXPORT_BUFFER_SIZE (1 << 20)
+
+struct export_job_t {
+    char *filename;
+    int num_vertices;
+    int num_edges;
+    int *vertices; // x, y and weight of every vertex
+    int *edges; // orig, dest and weight of every edge
+    int root;
+
+    // NOTE: written by the worker thread while the ui thread polls them, only accessed through
+    // export_atomic_store and export_atomic_load
+    volatile long lines_written;
+    volatile long done; // NOTE: stored last, once it is set the results below can be read
+
+    // results, only valid once done
+    bool ok;
+    size_t bytes_written;
+    double seconds;
+
+    bool threaded; // NOTE: false if the job had to run on the calling thread
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+};
+
+// release store, everything written before it is visible to the thread that loads the new value
+static inline void export_atomic_store(volatile long *p, long value) {
+#ifdef _WIN32
+    InterlockedExchange(p, value);
+#else
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+#endif
+}
+
+// acquire load, pairs with export_atomic_store
+static inline long export_atomic_load(volatile long *p) {
+#ifdef _WIN32
+    return InterlockedCompareExchange(p, 0, 0);
+#else
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+// writes the decimal representation of `value` to `out` (no terminator), returns the number of characters
+int format_int(char *out, int value) {
+    char digits[12];
+    unsigned int u = value < 0 ? 0u - (unsigned int) value : (unsigned int) value;
+    int n = 0;
+    do {
+        digits[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u);
+    int length = 0;
+    if (value < 0) {
+        out[length++] = '-';
+    }
+    while (n) {
+        out[length++] = digits[--n];
+    }
+    return length;
+}
+
+// formats a line with `count` integers separated by spaces, returns the number of characters
+int format_line(char *out, int *values, int count) {
+    int length = 0;
+    for (int i = 0; i < count; i++) {
+        length += format_int(&out[length], values[i]);
+        out[length++] = i + 1 < count ? ' ' : '\n';
+    }
+    return length;
+}
+
+// wall clock time in seconds (works without glfw)
+double wall_clock(void) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void export_job_run(export_job_t *job) {
+    double start = wall_clock();
+    job->ok = false;
+    job->bytes_written = 0;
+
+    FILE *f = fopen(job->filename, "wb");
+    char *buffer = malloc(EXPORT_BUFFER_SIZE);
+    assert(buffer);
+    if (f) {
+        // NOTE: a line has at most 4 integers of 11 characters plus separators
+        const int max_line_size = 4 * 12;
+        bool ok = true;
+        int used = 0;
+        int header[2] = {job->num_vertices, job->num_edges};
+        used += format_line(&buffer[used], header, 2);
+        int num_lines = job->num_vertices + job->num_edges;
+        for (int i = 0; i < num_lines && ok; i++) {
+            if (i < job->num_vertices) {
+                int line[4] = {i, job->vertices[3 * i], job->vertices[3 * i + 1], job->vertices[3 * i + 2]};
+                used += format_line(&buffer[used], line, 4);
+            } else {
+                used += format_line(&buffer[used], &job->edges[3 * (i - job->num_vertices)], 3);
+            }
+            if (used > EXPORT_BUFFER_SIZE - 2 * max_line_size) {
+                // NOTE: the loop stops at the first failed write, the file is reported as not written
+                ok = ok && fwrite(buffer, 1, used, f) == (size_t) used;
+                job->bytes_written += used;
+                used = 0;
+                export_atomic_store(&job->lines_written, i + 1);
+            }
+        }
+        used += format_line(&buffer[used], &job->root, 1);
+        ok = ok && fwrite(buffer, 1, used, f) == (size_t) used;
+        job->bytes_written += used;
+        job->ok = !fclose(f) && ok;
+    }
+    free(buffer);
+
+    export_atomic_store(&job->lines_written, job->num_vertices + job->num_edges);
+    job->seconds = wall_clock() - start;
+    export_atomic_store(&job->done, true);
+}
+
+#ifdef _WIN32
+DWORD WINAPI export_thread(LPVOID data) {
+    export_job_run(data);
+    return 0;
+}
+#else
+void *export_thread(void *data) {
+    export_job_run(data);
+    return NULL;
+}
+#endif
+
+// starts writing the job in a worker thread, which owns the job until export_job_finish()
+// NOTE: runs the job right away (blocking) if the thread could not be created
+void export_job_start(export_job_t *job) {
+    // NOTE: the thread is not running yet, creating it orders these stores before anything it does
+    job->lines_written = 0;
+    job->done = false;
+#ifdef _WIN32
+    job->thread = CreateThread(NULL, 0, export_thread, job, 0, NULL);
+    job->threaded = job->thread != NULL;
+#else
+    job->threaded = !pthread_create(&job->thread, NULL, export_thread, job);
+#endif
+    if (!job->threaded) {
+        export_job_run(job);
+    }
+}
+
+bool export_job_done(export_job_t *job) {
+    return export_atomic_load(&job->done);
+}
+
+// fraction of the lines already written, only meant for showing progress
+float export_job_progress(export_job_t *job) {
+    return (float) export_atomic_load(&job->lines_written) / max(job->num_vertices + job->num_edges, 1);
+}
+
+// waits for the worker thread, reports how the export went and frees the job, returns false if the file
+// could not be written
+bool export_job_finish(export_job_t *job) {
+    if (job->threaded) {
+#ifdef _WIN32
+        WaitForSingleObject(job->thread, INFINITE);
+        CloseHandle(job->thread);
+#else
+        pthread_join(job->thread, NULL);
+#endif
+    }
+
+    bool ok = job->ok;
+    if (ok) {
+        printf("%s: %d vertices, %d edges, %.1f MB in %.3f s (%.1f MB/s)\n", job->filename, job->num_vertices,
+               job->num_edges, job->bytes_written / 1e6, job->seconds, job->bytes_written / 1e6 / max(job->seconds, 1e-6));
+    } else {
+        fprintf(stderr, "Could not write %s\n", job->filename);
+    }
+    free(job->filename);
+    free(job->vertices);
+    free(job->edges);
+    free(job);
+    return ok;
+}
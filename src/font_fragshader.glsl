@@ -1,12 +1,12 @@
 #version 330
 
 uniform sampler2D tex;
-uniform vec3 color;
 
 in vec2 fragTexCoord;
+in vec3 fragColor;
 
 layout(location = 0) out vec4 finalColor;
 
 void main() {
-    finalColor = vec4(color, texture(tex, fragTexCoord).r);
+    finalColor = vec4(fragColor, texture(tex, fragTexCoord).r);
 }
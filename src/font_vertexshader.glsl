@@ -5,11 +5,14 @@ uniform float window_height;
 
 layout(location = 0) in vec3 vert;
 layout(location = 1) in vec2 vertTexCoord;
+layout(location = 2) in vec3 vertColor;
 
 out vec2 fragTexCoord;
+out vec3 fragColor;
 
 void main() {
     fragTexCoord = vertTexCoord;
+    fragColor = vertColor;
     
     vec3 v = vec3(vert.x / (window_width/2), vert.y / (window_height/2), vert.z);
     gl_Position = vec4(v, 1);
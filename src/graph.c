@@ -0,0 +1,732 @@
+// graph engine, everything the viewer does to a graph without touching the window or opengl
+//
+// compiled on its own into libgraph (see the Makefile), main.c and bench.c only go through graph.h
+
+#include "graph.h"
+
+#include "adjacency.c"
+#include "kernels.c"
+#include "spatial_grid.c"
+#include "bfs.c"
+#include "snapshot.c"
+#include "exporter.c"
+
+void graph_init(graph_t *graph) {
+    graph->positions = NULL;
+    graph->weights = NULL;
+    graph->selected = NULL;
+    graph->filled = NULL;
+    graph->fill_start = NULL;
+    graph->fill_count = NULL;
+    graph->num_circles = 0;
+    graph->circles_capacity = 0;
+    adjacency_init(&graph->adjacency);
+    grid_init(&graph->vertex_grid, 2.0f /* radius * 2 */);
+    bfs_init(&graph->bfs);
+    graph->fill_entrances = NULL;
+    graph->num_fill_entrances = 0;
+    graph->fill_entrances_capacity = 0;
+    graph->current_animation_root = -1;
+    graph->flood_depth = 0;
+    graph->flood_version = 0;
+}
+
+void graph_destroy(graph_t *graph) {
+    free(graph->positions);
+    free(graph->weights);
+    free(graph->selected);
+    free(graph->filled);
+    free(graph->fill_start);
+    free(graph->fill_count);
+    adjacency_destroy(&graph->adjacency);
+    grid_destroy(&graph->vertex_grid);
+    bfs_destroy(&graph->bfs);
+    free(graph->fill_entrances);
+    graph->fill_entrances = NULL;
+    graph->num_fill_entrances = 0;
+    graph->fill_entrances_capacity = 0;
+    graph->positions = NULL;
+    graph->weights = NULL;
+    graph->selected = NULL;
+    graph->filled = NULL;
+    graph->fill_start = NULL;
+    graph->fill_count = NULL;
+    graph->num_circles = 0;
+    graph->circles_capacity = 0;
+}
+
+// returns the index of the new vertex
+int graph_create_vertex(graph_t *graph, v2f p, int weight) {
+    int index = adjacency_add_vertex(&graph->adjacency);
+    if (index == graph->circles_capacity) {
+        graph->circles_capacity = graph->circles_capacity ? graph->circles_capacity * 2 : 64;
+        graph->positions = realloc(graph->positions, graph->circles_capacity * sizeof(*graph->positions));
+        graph->weights = realloc(graph->weights, graph->circles_capacity * sizeof(*graph->weights));
+        graph->selected = realloc(graph->selected, graph->circles_capacity * sizeof(*graph->selected));
+        graph->filled = realloc(graph->filled, graph->circles_capacity * sizeof(*graph->filled));
+        graph->fill_start = realloc(graph->fill_start, graph->circles_capacity * sizeof(*graph->fill_start));
+        graph->fill_count = realloc(graph->fill_count, graph->circles_capacity * sizeof(*graph->fill_count));
+        assert(graph->positions && graph->weights && graph->selected && graph->filled && graph->fill_start &&
+               graph->fill_count);
+    }
+    graph->positions[index] = p;
+    graph->weights[index] = weight;
+    graph->selected[index] = FALSE;
+    graph->filled[index] = 0;
+    graph->fill_start[index] = 0;
+    graph->fill_count[index] = 0;
+    graph->num_circles = graph->adjacency.num_rows;
+    grid_insert(&graph->vertex_grid, index, p);
+    return index;
+}
+
+// NOTE: only touches the edges of the deleted vertex, every other vertex keeps its index
+void graph_delete_vertex(graph_t *graph, int index) {
+    // the flood animation may reference the deleted vertex as an entrance
+    if (graph->current_animation_root != -1) {
+        graph_clear_flood(graph);
+    }
+    graph->selected[index] = FALSE;
+    grid_remove(&graph->vertex_grid, index, graph->positions[index]);
+    adjacency_remove_vertex(&graph->adjacency, index);
+    // NOTE: keeps the free slot out of the position kernels (see kernels.c)
+    graph->positions[index] = create_v2f(NAN, NAN);
+}
+
+// writes the index of every vertex inside the rectangle with corners `a` and `b` (in any order) to `out`,
+// returns how many there are
+// NOTE: `out` needs room for num_circles indices
+int graph_vertices_in_rect(graph_t *graph, v2f a, v2f b, int *out) {
+    v2f low = create_v2f(min(a.x, b.x), min(a.y, b.y));
+    v2f high = create_v2f(max(a.x, b.x), max(a.y, b.y));
+    // NOTE: the grid only pays off while the rectangle holds a small part of the graph, both ways return
+    // the vertices in increasing order
+    int count = grid_query_rect(&graph->vertex_grid, low, high, graph->num_circles / 16);
+    if (count == -1) {
+        return kernel_in_rect(graph->positions, graph->num_circles, low, high, out);
+    }
+    memcpy(out, graph->vertex_grid.results, count * sizeof(*out));
+    return count;
+}
+
+void graph_clear_flood(graph_t *graph) {
+    graph->current_animation_root = -1;
+    graph->flood_depth = 0;
+    graph->flood_version++;
+    memset(graph->filled, 0, graph->num_circles * sizeof(*graph->filled));
+    memset(graph->fill_count, 0, graph->num_circles * sizeof(*graph->fill_count));
+    graph->num_fill_entrances = 0;
+}
+
+// traverses the graph from `root_index` without touching the flood animation
+bfs_t *graph_bfs(graph_t *graph, int root_index) {
+    bfs_run(&graph->bfs, &graph->adjacency, root_index);
+    return &graph->bfs;
+}
+
+// returns true if `node` floods into `child` (an out-neighbor), `visited` marks the vertices that come
+// before `node` in the traversal order
+static inline bool graph_is_entrance(bfs_t *bfs, uint64_t *visited, int node, int child) {
+#if 1
+    // multi_entrance animation enabled
+    // NOTE: a vertex floods into every neighbor that comes after it in the traversal order, so edges
+    // inside a level are animated too
+    return !BFS_BIT_TEST(visited, child);
+#else
+    // multi_entrance animation disabled
+    return bfs->parents[child] == node;
+#endif
+}
+
+// starts the flood animation from `root_index`
+// NOTE: only computes when every entrance starts filling, the animation itself is played by the renderer
+void graph_flood(graph_t *graph, int root_index) {
+    bfs_t *bfs = graph_bfs(graph, root_index);
+    graph_clear_flood(graph);
+    int8_t *filled = graph->filled;
+    int *fill_start = graph->fill_start;
+    int *fill_count = graph->fill_count;
+    adjacency_t *adj = &graph->adjacency;
+    uint64_t *visited = bfs->frontier_bits;
+
+    // the entrances are counted first so every vertex gets a contiguous range of graph->fill_entrances
+    // (the root is its own entrance)
+    fill_count[root_index] = 1;
+    memset(visited, 0, BFS_BITMAP_WORDS(adj->num_rows) * sizeof(*visited));
+    for (int i = 0; i < bfs->num_reached; i++) {
+        int node = bfs->order[i];
+        BFS_BIT_SET(visited, node);
+        for (int j = 0; j < adjacency_degree(adj, node); j++) {
+            int children_index = adjacency_edge(adj, node, j)->dest;
+            if (graph_is_entrance(bfs, visited, node, children_index)) {
+                fill_count[children_index]++;
+            }
+        }
+    }
+    int num_entrances = 0;
+    for (int i = 0; i < bfs->num_reached; i++) {
+        int v = bfs->order[i];
+        filled[v] = 1;
+        fill_start[v] = num_entrances;
+        num_entrances += fill_count[v];
+        fill_count[v] = 0;
+    }
+    if (num_entrances > graph->fill_entrances_capacity) {
+        graph->fill_entrances_capacity = max(num_entrances, graph->fill_entrances_capacity * 2);
+        graph->fill_entrances = realloc(graph->fill_entrances, graph->fill_entrances_capacity * sizeof(*graph->fill_entrances));
+        assert(graph->fill_entrances);
+    }
+    graph->num_fill_entrances = num_entrances;
+
+    fill_entrance_t *entrances = graph->fill_entrances;
+    // NOTE: a vertex is filled once the flood crossed it through its first entrance, which comes from the
+    // previous level (so every vertex of level L is filled at graph_flood_level_end(L))
+    entrances[fill_start[root_index] + fill_count[root_index]++] = (fill_entrance_t) {root_index, 0};
+    graph->current_animation_root = root_index;
+    graph->flood_depth = bfs->depth;
+    memset(visited, 0, BFS_BITMAP_WORDS(adj->num_rows) * sizeof(*visited));
+    for (int i = 0; i < bfs->num_reached; i++) {
+        int node = bfs->order[i];
+        BFS_BIT_SET(visited, node);
+        for (int j = 0; j < adjacency_degree(adj, node); j++) {
+            int children_index = adjacency_edge(adj, node, j)->dest;
+            if (graph_is_entrance(bfs, visited, node, children_index)) {
+                float start = graph_flood_level_end(bfs->levels[node]) + FLOOD_EDGE_SECONDS;
+                entrances[fill_start[children_index] + fill_count[children_index]++] = (fill_entrance_t) {node, start};
+            }
+        }
+    }
+}
+
+// seconds into the flood animation when the vertex is completely filled, INFINITY if the flood doesn't reach it
+// NOTE: the flood leaves through the out-edges of the vertex from then on
+float graph_fill_end(graph_t *graph, int index) {
+    if (!graph->filled[index]) {
+        return INFINITY;
+    }
+    if (index == graph->current_animation_root) {
+        return graph_flood_level_end(0);
+    }
+    // NOTE: the first entrance is the earliest one (the fathers are visited in traversal order)
+    return graph->fill_entrances[graph->fill_start[index]].start + FLOOD_CROSS_SECONDS;
+}
+
+// seconds into the flood animation when every vertex of the level is filled
+// NOTE: the whole animation is a function of the time, so this is all it takes to seek to the end of a level
+float graph_flood_level_end(int level) {
+    return FLOOD_ROOT_SECONDS + level * (FLOOD_EDGE_SECONDS + FLOOD_CROSS_SECONDS);
+}
+
+// number of levels of the current flood completely filled `time` seconds into the animation (from 0 to
+// flood_depth + 1)
+int graph_flood_levels_at(graph_t *graph, double time) {
+    if (graph->current_animation_root == -1 || time < graph_flood_level_end(0)) {
+        return 0;
+    }
+    int levels = (int) ((time - FLOOD_ROOT_SECONDS) / (FLOOD_EDGE_SECONDS + FLOOD_CROSS_SECONDS)) + 1;
+    levels = min(levels, graph->flood_depth + 1);
+    // NOTE: fixes the rounding of the division, the end of a level counts as filled
+    while (levels <= graph->flood_depth && graph_flood_level_end(levels) <= time) {
+        levels++;
+    }
+    while (levels > 0 && graph_flood_level_end(levels - 1) > time) {
+        levels--;
+    }
+    return levels;
+}
+
+// graph generators
+// NOTE: every generator reserves the exact capacity it needs, appends the edges in a single pass
+// (adjacency_append_edge) and compacts the adjacency store once at the end
+
+#define GENERATOR_SPACING 4.0f /* radius * 4 */
+
+void generator_report(graph_t *graph, const char *name) {
+    printf("%s: %d vertices, %d edges\n", name, graph->adjacency.num_vertices, graph->adjacency.num_edges);
+}
+
+// creates `n` vertices laid out in rows of `columns` starting at `origin`, returns their slots (this
+// function allocates the array) or NULL if they don't fit
+int *graph_create_vertices(graph_t *graph, int n, int columns, v2f origin) {
+    if (n < 0) {
+        fprintf(stderr, "Cannot generate %d vertices\n", n);
+        return NULL;
+    }
+    int *slots = malloc(max(n, 1) * sizeof(*slots));
+    assert(slots);
+    for (int i = 0; i < n; i++) {
+        v2f pos = create_v2f(origin.x + (i % columns) * GENERATOR_SPACING, origin.y - (i / columns) * GENERATOR_SPACING);
+        slots[i] = graph_create_vertex(graph, pos, 1);
+    }
+    return slots;
+}
+
+// adds every missing edge (with weight 1) between the existing vertices
+void graph_generate_complete(graph_t *graph) {
+    adjacency_t *adj = &graph->adjacency;
+
+    // NOTE: after compacting every row is a sorted csr segment, so its missing edges are found by merging
+    // it with the (sorted) list of vertices
+    adjacency_compact(adj);
+    for (int i = 0; i < adj->num_rows; i++) {
+        if (!adjacency_is_vertex(adj, i)) {
+            continue;
+        }
+        bool self_loop = adjacency_find_edge_index(adj, i, i) != -1;
+        adjacency_reserve(adj, i, adj->num_vertices - 1 - (adjacency_degree(adj, i) - self_loop));
+        adjacency_reserve_parents(adj, i, adj->num_vertices - 1 - (adjacency_in_degree(adj, i) - self_loop));
+    }
+    for (int i = 0; i < adj->num_rows; i++) {
+        if (!adjacency_is_vertex(adj, i)) {
+            continue;
+        }
+        adjacency_row_t *row = &adj->rows[i];
+        edge_t *base = &adj->csr[row->start];
+        int k = 0;
+        for (int j = 0; j < adj->num_rows; j++) {
+            if (j == i || !adjacency_is_vertex(adj, j)) {
+                continue;
+            }
+            while (k < row->num_base && base[k].dest < j) {
+                k++;
+            }
+            if (k == row->num_base || base[k].dest != j) {
+                adjacency_append_edge(adj, i, j, 1);
+            }
+        }
+    }
+    adjacency_compact(adj);
+    generator_report(graph, "complete");
+}
+
+// adds a complete bipartite graph with edges from every one of the `a` left vertices to every one of the
+// `b` right vertices
+void graph_generate_complete_bipartite(graph_t *graph, int a, int b, v2f origin) {
+    adjacency_t *adj = &graph->adjacency;
+    int *left = graph_create_vertices(graph, a, 1, create_v2f(origin.x, origin.y - (max(b - a, 0) / 2) * GENERATOR_SPACING));
+    if (!left) {
+        return;
+    }
+    int *right = graph_create_vertices(graph, b, 1, create_v2f(origin.x + 5 * GENERATOR_SPACING, origin.y - (max(a - b, 0) / 2) * GENERATOR_SPACING));
+    if (!right) {
+        free(left);
+        return;
+    }
+    for (int i = 0; i < a; i++) {
+        adjacency_reserve(adj, left[i], b);
+    }
+    for (int j = 0; j < b; j++) {
+        adjacency_reserve_parents(adj, right[j], a);
+    }
+    for (int i = 0; i < a; i++) {
+        for (int j = 0; j < b; j++) {
+            adjacency_append_edge(adj, left[i], right[j], 1);
+        }
+    }
+    adjacency_compact(adj);
+    free(left);
+    free(right);
+    generator_report(graph, "complete bipartite");
+}
+
+// adds a random G(n, p) graph: every ordered pair of distinct new vertices gets an edge with probability p
+void graph_generate_random(graph_t *graph, int n, double p, v2f origin) {
+    adjacency_t *adj = &graph->adjacency;
+    int *slots = graph_create_vertices(graph, n, max((int) ceil(sqrt(n)), 1), origin);
+    if (!slots) {
+        return;
+    }
+
+    // NOTE: instead of tossing a coin for each pair, the distance to the next chosen pair is drawn from a
+    // geometric distribution, so this costs O(n + number of edges)
+    // NOTE: every edge is drawn first (as indices into slots) so the in-degrees are known before the
+    // parents lists are reserved
+    double log_q = p < 1 ? log(1 - p) : 0;
+    int *children = NULL;
+    int num_children = 0;
+    int children_capacity = 0;
+    int *first_child = malloc((n + 1) * sizeof(*first_child)); // children of i are first_child[i] .. first_child[i + 1]
+    int *in_degree = calloc(max(n, 1), sizeof(*in_degree));
+    assert(first_child && in_degree);
+    for (int i = 0; i < n; i++) {
+        first_child[i] = num_children;
+        for (int j = -1; p > 0;) {
+            if (p >= 1) {
+                j++;
+            } else {
+                double r = (rand() + 0.5) / ((double) RAND_MAX + 1);
+                j += 1 + (int) min(log(r) / log_q, (double) n);
+            }
+            if (j >= n - 1) {
+                break;
+            }
+            if (num_children == children_capacity) {
+                children_capacity = max(n, 2 * children_capacity);
+                children = realloc(children, children_capacity * sizeof(*children));
+                assert(children);
+            }
+            // NOTE: j indexes the other n - 1 vertices, skipping i itself
+            int child = j < i ? j : j + 1;
+            children[num_children++] = child;
+            in_degree[child]++;
+        }
+    }
+    first_child[n] = num_children;
+
+    for (int i = 0; i < n; i++) {
+        adjacency_reserve(adj, slots[i], first_child[i + 1] - first_child[i]);
+        adjacency_reserve_parents(adj, slots[i], in_degree[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        for (int k = first_child[i]; k < first_child[i + 1]; k++) {
+            adjacency_append_edge(adj, slots[i], slots[children[k]], 1);
+        }
+    }
+    adjacency_compact(adj);
+    free(children);
+    free(first_child);
+    free(in_degree);
+    free(slots);
+    generator_report(graph, "random");
+}
+
+// adds a w x h grid graph with edges pointing right and down
+void graph_generate_grid(graph_t *graph, int w, int h, v2f origin) {
+    adjacency_t *adj = &graph->adjacency;
+    int *slots = graph_create_vertices(graph, w * h, max(w, 1), origin);
+    if (!slots) {
+        return;
+    }
+    for (int i = 0; i < w * h; i++) {
+        int x = i % w;
+        int y = i / w;
+        adjacency_reserve(adj, slots[i], (x + 1 < w) + (y + 1 < h));
+        adjacency_reserve_parents(adj, slots[i], (x > 0) + (y > 0));
+    }
+    for (int i = 0; i < w * h; i++) {
+        if (i % w + 1 < w) {
+            adjacency_append_edge(adj, slots[i], slots[i + 1], 1);
+        }
+        if (i / w + 1 < h) {
+            adjacency_append_edge(adj, slots[i], slots[i + w], 1);
+        }
+    }
+    adjacency_compact(adj);
+    free(slots);
+    generator_report(graph, "grid");
+}
+
+// skips whitespace and parses a (possibly negative) integer, advancing the cursor past it
+// NOTE: hand-rolled because fscanf/strtol dominate the time spent loading big graphs
+bool read_int(char **cursor, char *end, int *value) {
+    char *c = *cursor;
+    while (c < end && (*c == ' ' || *c == '\n' || *c == '\r' || *c == '\t')) {
+        c++;
+    }
+    bool negative = c < end && *c == '-';
+    if (negative) {
+        c++;
+    }
+    if (c == end || *c < '0' || *c > '9') {
+        return false;
+    }
+    int result = 0;
+    while (c < end && *c >= '0' && *c <= '9') {
+        int digit = *c - '0';
+        if (result > (INT_MAX - digit) / 10) {
+            return false; // NOTE: does not fit in an int, treated as malformed
+        }
+        result = result * 10 + digit;
+        c++;
+    }
+    *value = negative ? -result : result;
+    *cursor = c;
+    return true;
+}
+
+// adds the graph stored in `filename` (in the format written by graph_export) to the current one, returns false
+// if the file could not be read or is malformed (nothing is added in that case)
+// NOTE: duplicated edges are not checked for
+bool graph_load(graph_t *graph, char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return false;
+    }
+    long file_size = fseek(f, 0, SEEK_END) ? -1 : ftell(f);
+    if (file_size < 0) {
+        fprintf(stderr, "Could not read %s\n", filename);
+        fclose(f);
+        return false;
+    }
+    size_t size = (size_t) file_size;
+    rewind(f);
+    // NOTE: not asserted, the size comes from the file (directories report a bogus one, for example)
+    char *buffer = malloc(max(size, 1));
+    if (!buffer) {
+        fprintf(stderr, "Could not read %s\n", filename);
+        fclose(f);
+        return false;
+    }
+    char *cursor = buffer;
+    char *end = buffer + fread(buffer, 1, size, f);
+    fclose(f);
+
+    // the whole file is parsed and validated before anything is added to the graph
+    int num_vertices = 0;
+    int num_edges = 0;
+    bool ok = read_int(&cursor, end, &num_vertices) && read_int(&cursor, end, &num_edges) &&
+              num_vertices >= 0 && num_edges >= 0;
+    // every vertex and edge line takes at least 6 bytes ("0 0 0\n"), so counts the file cannot hold are rejected
+    // before they are used to size the allocations below
+    ok = ok && ((size_t) num_vertices + (size_t) num_edges) <= size / 6;
+    int *vertices = NULL; // x, y and weight of every vertex, indexed by id
+    int *edges = NULL; // orig, dest and weight of every edge
+    int *out_degree = NULL;
+    int *in_degree = NULL;
+    if (ok) {
+        vertices = malloc(max((size_t) num_vertices, 1) * 3 * sizeof(*vertices));
+        edges = malloc(max((size_t) num_edges, 1) * 3 * sizeof(*edges));
+        out_degree = calloc(max(num_vertices, 1), sizeof(*out_degree));
+        in_degree = calloc(max(num_vertices, 1), sizeof(*in_degree));
+        assert(vertices && edges && out_degree && in_degree);
+    }
+    for (int i = 0; ok && i < num_vertices; i++) {
+        int id;
+        ok = read_int(&cursor, end, &id) && id >= 0 && id < num_vertices && !in_degree[id];
+        ok = ok && read_int(&cursor, end, &vertices[3 * id]) && read_int(&cursor, end, &vertices[3 * id + 1]) &&
+             read_int(&cursor, end, &vertices[3 * id + 2]);
+        if (ok) {
+            in_degree[id] = 1; // NOTE: marks the id as seen, reset below
+        }
+    }
+    for (int i = 0; ok && i < num_vertices; i++) {
+        in_degree[i] = 0;
+    }
+    for (int i = 0; ok && i < num_edges; i++) {
+        int *edge = &edges[3 * i];
+        ok = read_int(&cursor, end, &edge[0]) && read_int(&cursor, end, &edge[1]) && read_int(&cursor, end, &edge[2]) &&
+             edge[0] >= 0 && edge[0] < num_vertices && edge[1] >= 0 && edge[1] < num_vertices;
+        if (ok) {
+            out_degree[edge[0]]++;
+            in_degree[edge[1]]++;
+        }
+    }
+    // NOTE: the root written by export (if any) is ignored
+
+    if (ok) {
+        adjacency_t *adj = &graph->adjacency;
+        int *slots = out_degree; // NOTE: reused once the vertex has reserved its edges
+        for (int i = 0; i < num_vertices; i++) {
+            int *vertex = &vertices[3 * i];
+            int slot = graph_create_vertex(graph, create_v2f(vertex[0] / 4.0, vertex[1] / 4.0), vertex[2]);
+            adjacency_reserve(adj, slot, out_degree[i]);
+            adjacency_reserve_parents(adj, slot, in_degree[i]);
+            slots[i] = slot;
+        }
+        for (int i = 0; i < num_edges; i++) {
+            int *edge = &edges[3 * i];
+            adjacency_append_edge(adj, slots[edge[0]], slots[edge[1]], edge[2]);
+        }
+        adjacency_compact(adj);
+        printf("%s: %d vertices, %d edges\n", filename, num_vertices, num_edges);
+    } else {
+        fprintf(stderr, "Malformed graph file: %s\n", filename);
+    }
+
+    free(buffer);
+    free(vertices);
+    free(edges);
+    free(out_degree);
+    free(in_degree);
+    return ok;
+}
+
+// copies the graph and starts writing it to `filename` in the background (see exporter.c)
+// the returned job must be handed to export_job_finish() once export_job_done() says so
+export_job_t *graph_export(graph_t *graph, char *filename) {
+    adjacency_t *adj = &graph->adjacency;
+    export_job_t *job = malloc(sizeof(*job));
+    assert(job);
+    job->filename = malloc(strlen(filename) + 1);
+    strcpy(job->filename, filename);
+    job->num_vertices = adj->num_vertices;
+    job->num_edges = adj->num_edges;
+    job->vertices = malloc(max(adj->num_vertices, 1) * 3 * sizeof(*job->vertices));
+    job->edges = malloc(max(adj->num_edges, 1) * 3 * sizeof(*job->edges));
+    job->root = adj->num_vertices ? rand() % adj->num_vertices : 0;
+
+    // NOTE: free slots are skipped, so vertices are renumbered densely in slot order
+    int *ids = malloc(max(graph->num_circles, 1) * sizeof(*ids));
+    assert(job->filename && job->vertices && job->edges && ids);
+    int num_ids = 0;
+    for (int i = 0; i < graph->num_circles; i++) {
+        if (!adjacency_is_vertex(adj, i)) {
+            ids[i] = -1;
+            continue;
+        }
+        int *vertex = &job->vertices[3 * num_ids];
+        vertex[0] = (int) (graph->positions[i].x * 4);
+        vertex[1] = (int) (graph->positions[i].y * 4);
+        vertex[2] = graph->weights[i];
+        ids[i] = num_ids++;
+    }
+    int e = 0;
+    for (int i = 0; i < graph->num_circles; i++) {
+        for (int j = 0; j < adjacency_degree(adj, i); j++, e++) {
+            edge_t *edge = adjacency_edge(adj, i, j);
+            job->edges[3 * e] = ids[i];
+            job->edges[3 * e + 1] = ids[edge->dest];
+            job->edges[3 * e + 2] = edge->weight;
+        }
+    }
+    free(ids);
+
+    export_job_start(job);
+    return job;
+}
+
+// returns true if `filename` is a snapshot rather than a text export
+bool graph_is_snapshot(char *filename) {
+    return snapshot_is_snapshot(filename);
+}
+
+// writes a binary snapshot of the graph, the view (if `view` is not NULL) and the flood animation (see
+// snapshot.c), returns false if the file could not be written
+bool graph_save_snapshot(graph_t *graph, char *filename, graph_view_t *view) {
+    adjacency_t *adj = &graph->adjacency;
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return false;
+    }
+
+    snapshot_header_t header = {0};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.num_vertices = adj->num_vertices;
+    header.num_edges = adj->num_edges;
+    if (view && view->has_view) {
+        header.flags |= SNAPSHOT_HAS_VIEW;
+        header.zoom = view->zoom;
+        header.translation_x = view->translation.x;
+        header.translation_y = view->translation.y;
+    }
+    header.animation_root = -1;
+
+    // NOTE: free slots are skipped, so vertices are renumbered densely in slot order (which keeps every
+    // csr segment sorted)
+    int *ids = malloc(max(graph->num_circles, 1) * sizeof(*ids));
+    double *positions = malloc(max(adj->num_vertices, 1) * 2 * sizeof(*positions));
+    int32_t *vertex_weights = malloc(max(adj->num_vertices, 1) * sizeof(*vertex_weights));
+    uint32_t *offsets = malloc((adj->num_vertices + 1) * sizeof(*offsets));
+    int32_t *dests = malloc(max(adj->num_edges, 1) * sizeof(*dests));
+    int32_t *weights = malloc(max(adj->num_edges, 1) * sizeof(*weights));
+    uint8_t *reciprocal = malloc(max(adj->num_edges, 1) * sizeof(*reciprocal));
+    uint32_t *parent_offsets = malloc((adj->num_vertices + 1) * sizeof(*parent_offsets));
+    int32_t *parents = malloc(max(adj->num_edges, 1) * sizeof(*parents));
+    assert(ids && positions && vertex_weights && offsets && dests && weights);
+    assert(reciprocal && parent_offsets && parents);
+
+    int num_ids = 0;
+    for (int i = 0; i < graph->num_circles; i++) {
+        ids[i] = adjacency_is_vertex(adj, i) ? num_ids++ : -1;
+    }
+    if (graph->current_animation_root != -1) {
+        header.flags |= SNAPSHOT_HAS_ANIMATION;
+        header.animation_root = ids[graph->current_animation_root];
+    }
+
+    // NOTE: the overflow edges may be unsorted, so the store is compacted first
+    adjacency_compact(adj);
+    int e = 0;
+    int p = 0;
+    for (int i = 0; i < graph->num_circles; i++) {
+        if (ids[i] == -1) {
+            continue;
+        }
+        positions[2 * ids[i]] = graph->positions[i].x;
+        positions[2 * ids[i] + 1] = graph->positions[i].y;
+        vertex_weights[ids[i]] = graph->weights[i];
+        offsets[ids[i]] = e;
+        for (int j = 0; j < adjacency_degree(adj, i); j++, e++) {
+            edge_t *edge = adjacency_edge(adj, i, j);
+            dests[e] = ids[edge->dest];
+            weights[e] = edge->weight;
+            reciprocal[e] = edge->reciprocal;
+        }
+        parent_offsets[ids[i]] = p;
+        for (int j = 0; j < adjacency_in_degree(adj, i); j++, p++) {
+            parents[p] = ids[adjacency_parent(adj, i, j)];
+        }
+    }
+    offsets[adj->num_vertices] = e;
+    parent_offsets[adj->num_vertices] = p;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(positions, sizeof(*positions), 2 * adj->num_vertices, f) == 2 * (size_t) adj->num_vertices &&
+              fwrite(vertex_weights, sizeof(*vertex_weights), adj->num_vertices, f) == (size_t) adj->num_vertices &&
+              fwrite(offsets, sizeof(*offsets), adj->num_vertices + 1, f) == (size_t) adj->num_vertices + 1 &&
+              fwrite(dests, sizeof(*dests), adj->num_edges, f) == (size_t) adj->num_edges &&
+              fwrite(weights, sizeof(*weights), adj->num_edges, f) == (size_t) adj->num_edges &&
+              fwrite(parent_offsets, sizeof(*parent_offsets), adj->num_vertices + 1, f) ==
+                  (size_t) adj->num_vertices + 1 &&
+              fwrite(parents, sizeof(*parents), adj->num_edges, f) == (size_t) adj->num_edges &&
+              fwrite(reciprocal, sizeof(*reciprocal), adj->num_edges, f) == (size_t) adj->num_edges;
+    ok = !fclose(f) && ok;
+    if (ok) {
+        printf("%s: %d vertices, %d edges\n", filename, adj->num_vertices, adj->num_edges);
+    } else {
+        fprintf(stderr, "Could not write %s\n", filename);
+    }
+
+    free(ids);
+    free(positions);
+    free(vertex_weights);
+    free(offsets);
+    free(dests);
+    free(weights);
+    free(reciprocal);
+    free(parent_offsets);
+    free(parents);
+    return ok;
+}
+
+// adds the graph stored in the snapshot `filename` to the current one and restarts its animation, the view
+// is stored in `view` (if not NULL), returns false if the file is not a valid snapshot
+bool graph_load_snapshot(graph_t *graph, char *filename, graph_view_t *view) {
+    snapshot_t snapshot;
+    if (!snapshot_open(&snapshot, filename)) {
+        fprintf(stderr, "Invalid snapshot: %s\n", filename);
+        return false;
+    }
+    snapshot_header_t *header = snapshot.header;
+    adjacency_t *adj = &graph->adjacency;
+
+    int *slots = malloc(max(header->num_vertices, 1) * sizeof(*slots));
+    assert(slots);
+    for (uint32_t i = 0; i < header->num_vertices; i++) {
+        v2f pos = create_v2f(snapshot.positions[2 * i], snapshot.positions[2 * i + 1]);
+        slots[i] = graph_create_vertex(graph, pos, snapshot.vertex_weights[i]);
+    }
+    // NOTE: the edges are already laid out as csr segments and the parents and flags are stored too, so they are
+    // copied into place without compacting or recomputing anything
+    adjacency_append_csr(adj, slots, header->num_vertices, snapshot.offsets, snapshot.dests, snapshot.weights,
+                         snapshot.reciprocal, snapshot.parent_offsets, snapshot.parents);
+
+    if (view) {
+        view->has_view = header->flags & SNAPSHOT_HAS_VIEW;
+        view->zoom = header->zoom;
+        view->translation = create_v2f(header->translation_x, header->translation_y);
+    }
+    if ((header->flags & SNAPSHOT_HAS_ANIMATION) && header->animation_root >= 0 &&
+        (uint32_t) header->animation_root < header->num_vertices) {
+        // NOTE: the animation starts over from its root
+        graph_flood(graph, slots[header->animation_root]);
+    }
+    printf("%s: %d vertices, %d edges\n", filename, header->num_vertices, header->num_edges);
+
+    free(slots);
+    snapshot_close(&snapshot);
+    return true;
+}
@@ -0,0 +1,262 @@
+// graph engine: vertices, edges, traversal, generators and file formats (no glfw or opengl)
+//
+// built as a static library (libgraph.a, see the Makefile) from graph.c and linked by the viewer and by
+// the benchmark
+
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+
+#include "constants.h"
+
+#define TRUE 1
+#define FALSE 0
+#define max(a, b) (a > b ? a : b)
+#define min(a, b) (a < b ? a : b)
+
+#define NUMERIC_TYPE double
+#define TYPE_NAME v2f
+#include "math.c"
+#undef NUMERIC_TYPE
+#undef TYPE_NAME
+
+
+// adjacency store (adjacency.c)
+
+typedef struct {
+    //int orig; // NOTE: unused
+    int dest;
+    int weight;
+    bool reciprocal; // NOTE: true if the edge dest -> orig also exists (never for self loops), kept up to date by the mutators
+
+    v2f weight_pos_screen;
+} edge_t;
+
+typedef struct {
+    int start; // first edge of this vertex inside the csr array
+    int num_base; // number of live edges inside the csr segment
+    edge_t *overflow; // edges added after the last compaction
+    int num_overflow;
+    int overflow_capacity;
+
+    int *parents; // source of every in-edge (a vertex appears once per edge, in no particular order)
+    int num_parents;
+    int parents_capacity;
+
+    bool alive; // NOTE: false means this slot is free
+} adjacency_row_t;
+
+typedef struct {
+    adjacency_row_t *rows;
+    int num_rows; // NOTE: number of slots, including the free ones
+    int rows_capacity;
+    int num_vertices;
+
+    int *free_rows; // stack of free slots
+    int num_free_rows;
+    int free_rows_capacity;
+
+    edge_t *csr;
+    int csr_size; // NOTE: includes the holes left by removed edges until the next compaction
+
+    int num_edges;
+    int version; // NOTE: bumped on every mutation, lets caches built on top of the edges know when to rebuild
+} adjacency_t;
+
+void adjacency_init(adjacency_t *adj);
+void adjacency_destroy(adjacency_t *adj);
+bool adjacency_is_vertex(adjacency_t *adj, int v);
+int adjacency_degree(adjacency_t *adj, int v);
+int adjacency_in_degree(adjacency_t *adj, int v);
+edge_t *adjacency_edge(adjacency_t *adj, int v, int k);
+int adjacency_parent(adjacency_t *adj, int v, int k);
+int adjacency_find_edge_index(adjacency_t *adj, int orig, int dest);
+edge_t *adjacency_find_edge(adjacency_t *adj, int orig, int dest);
+bool adjacency_has_edge(adjacency_t *adj, int orig, int dest);
+int adjacency_add_vertex(adjacency_t *adj);
+void adjacency_reserve(adjacency_t *adj, int v, int count);
+void adjacency_reserve_parents(adjacency_t *adj, int v, int count);
+edge_t *adjacency_append_edge(adjacency_t *adj, int orig, int dest, int weight);
+void adjacency_append_csr(adjacency_t *adj, const int *rows, int num_rows, const uint32_t *offsets,
+                          const int32_t *dests, const int32_t *weights, const uint8_t *reciprocal,
+                          const uint32_t *parent_offsets, const int32_t *parents);
+edge_t *adjacency_add_edge(adjacency_t *adj, int orig, int dest, int weight);
+void adjacency_remove_edge_at(adjacency_t *adj, int v, int k);
+bool adjacency_remove_edge(adjacency_t *adj, int orig, int dest);
+void adjacency_remove_vertex(adjacency_t *adj, int index);
+void adjacency_compact(adjacency_t *adj);
+
+
+// batch kernels over positions (kernels.c)
+
+int kernel_nearest(const v2f *positions, int n, v2f p, double *distance_squared);
+int kernel_in_rect(const v2f *positions, int n, v2f min, v2f max, int *out);
+
+
+// uniform grid (spatial_grid.c)
+
+typedef struct {
+    int *ids;
+    v2f *positions; // NOTE: positions[i] is the position of ids[i]
+    int num_entries;
+    int capacity;
+} grid_bucket_t;
+
+typedef struct {
+    grid_bucket_t *buckets;
+    int num_buckets; // NOTE: always a power of two
+    double cell_size;
+    int num_entries;
+    int *results; // NOTE: ids found by the last grid_query_rect
+    int results_capacity;
+} spatial_grid_t;
+
+void grid_init(spatial_grid_t *grid, double cell_size);
+void grid_destroy(spatial_grid_t *grid);
+void grid_clear(spatial_grid_t *grid);
+void grid_insert(spatial_grid_t *grid, int id, v2f pos);
+bool grid_remove(spatial_grid_t *grid, int id, v2f pos);
+void grid_move(spatial_grid_t *grid, int id, v2f old_pos, v2f new_pos);
+void grid_query_radius(spatial_grid_t *grid, v2f pos, double radius,
+                       void (*callback)(void *data, int id, v2f entry_pos), void *data);
+int grid_find_nearest(spatial_grid_t *grid, v2f pos, double radius);
+int grid_query_rect(spatial_grid_t *grid, v2f min, v2f max, int max_results);
+
+
+// breadth-first search (bfs.c)
+
+#define BFS_BITMAP_WORDS(n) (((n) + 63) / 64)
+#define BFS_MAX_THREADS 64
+
+// scratch of a thread of the parallel traversal
+typedef struct {
+    int *found; // vertices reached by this thread during the current step
+    int num_found;
+    int found_capacity;
+    int64_t next_edges; // out-edges of the vertices in found
+} bfs_thread_t;
+
+typedef struct {
+    int thread;
+    int start; // NOTE: inside the buffer of the thread
+    int count;
+} bfs_chunk_t;
+
+typedef struct bfs_pool_t bfs_pool_t;
+
+typedef struct {
+    int root; // NOTE: -1 until the first traversal
+    int *levels; // level of every vertex slot, -1 for the ones that were not reached
+    int *parents; // vertex every one was reached from, -1 for the root and for the ones that were not reached
+    int *order; // the reached vertices in the order they were reached (level by level)
+    int num_reached;
+    int depth;
+    int num_bottom_up_levels;
+
+    int num_threads; // NOTE: 1 (the default) means the calling thread does all the work
+    bfs_pool_t *pool; // the other num_threads - 1 threads, started by bfs_set_threads (NULL with a single thread)
+
+    // scratch, reused between traversals
+    uint64_t *frontier_bits;
+    uint64_t *visited_bits;
+    int64_t *keys; // smallest (frontier position, edge index) that reached every vertex, see bfs_work
+    bfs_chunk_t *chunks;
+    bfs_thread_t threads[BFS_MAX_THREADS];
+    int capacity;
+} bfs_t;
+
+void bfs_init(bfs_t *bfs);
+void bfs_destroy(bfs_t *bfs);
+void bfs_set_threads(bfs_t *bfs, int num_threads);
+void bfs_run(bfs_t *bfs, adjacency_t *adj, int root);
+
+
+// background text export (exporter.c)
+
+typedef struct export_job_t export_job_t;
+
+bool export_job_done(export_job_t *job);
+float export_job_progress(export_job_t *job);
+bool export_job_finish(export_job_t *job);
+double wall_clock(void);
+
+
+// graph (graph.c)
+
+// timing of the flood animation: the root fills in FLOOD_ROOT_SECONDS, then the flood runs along the out-edges
+// of every filled vertex in FLOOD_EDGE_SECONDS, goes into the vertices at their ends through an entrance and
+// takes FLOOD_CROSS_SECONDS to cross them
+#define FLOOD_ROOT_SECONDS 1.0f
+#define FLOOD_EDGE_SECONDS 1.0f
+#define FLOOD_CROSS_SECONDS 2.0f
+
+// a vertex the flood enters another one from
+typedef struct {
+    int vertex; // index of the "father"
+    float start; // seconds into the animation when the flood starts entering through here
+} fill_entrance_t;
+
+typedef struct {
+    // vertex data, one array per field so the passes over every vertex only touch the fields they use
+    // NOTE: indexed by the vertex slots of the adjacency store
+    v2f *positions;
+    int *weights;
+    bool *selected;
+    int8_t *filled; // 1 if the vertex is reached by the current flood, 0 otherwise
+    int *fill_start; // first entrance of the vertex inside fill_entrances
+    int *fill_count; // number of entrances of the vertex
+    int num_circles; // NOTE: number of slots, free slots must be skipped (see adjacency_is_vertex)
+    int circles_capacity;
+    adjacency_t adjacency; // out-edges of every vertex
+    spatial_grid_t vertex_grid; // position of every vertex, used for picking
+    bfs_t bfs; // result of the last traversal, NOTE: only valid until the graph changes
+
+    fill_entrance_t *fill_entrances; // entrances of every vertex being flooded (see fill_start)
+    int num_fill_entrances;
+    int fill_entrances_capacity;
+
+    int current_animation_root; // index of the current animation root vertex (-1 means no animation)
+    int flood_depth; // deepest level reached by the current flood
+    int flood_version; // NOTE: bumped every time the flood changes, lets the renderer know when to rebuild
+} graph_t;
+
+// what a snapshot stores besides the graph
+typedef struct {
+    bool has_view; // NOTE: false means zoom and translation were not stored
+    double zoom;
+    v2f translation;
+} graph_view_t;
+
+void graph_init(graph_t *graph);
+void graph_destroy(graph_t *graph);
+int graph_create_vertex(graph_t *graph, v2f p, int weight);
+void graph_delete_vertex(graph_t *graph, int index);
+void graph_clear_flood(graph_t *graph);
+int graph_vertices_in_rect(graph_t *graph, v2f a, v2f b, int *out);
+bfs_t *graph_bfs(graph_t *graph, int root_index);
+void graph_flood(graph_t *graph, int root_index);
+float graph_fill_end(graph_t *graph, int index);
+float graph_flood_level_end(int level);
+int graph_flood_levels_at(graph_t *graph, double time);
+
+void graph_generate_complete(graph_t *graph);
+int *graph_create_vertices(graph_t *graph, int n, int columns, v2f origin);
+void graph_generate_complete_bipartite(graph_t *graph, int a, int b, v2f origin);
+void graph_generate_random(graph_t *graph, int n, double p, v2f origin);
+void graph_generate_grid(graph_t *graph, int w, int h, v2f origin);
+
+bool graph_load(graph_t *graph, char *filename);
+export_job_t *graph_export(graph_t *graph, char *filename);
+bool graph_is_snapshot(char *filename);
+bool graph_load_snapshot(graph_t *graph, char *filename, graph_view_t *view);
+bool graph_save_snapshot(graph_t *graph, char *filename, graph_view_t *view);
+
+#endif
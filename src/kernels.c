@@ -0,0 +1,227 @@
+// batch kernels over arrays of positions: nearest point to a cursor and points inside a rectangle
+//
+// every kernel has a scalar version and, on x86, an SSE2 version (2 points per step, always available on
+// x86-64) and an AVX2 version (4 points per step) picked at runtime when the cpu supports it. the vector
+// versions only compare, the (rare) hits are then handled one by one, so every version returns exactly
+// the same result as the scalar one.
+//
+// NOTE: positions with a NAN coordinate never match (every comparison with NAN is false), graph.c uses
+// that to keep deleted vertices out without a separate mask
+
+// NOTE: the prototypes are declared in graph.h
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define KERNELS_SSE2
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <immintrin.h>
+    #define KERNELS_AVX2
+    #define KERNELS_AVX2_TARGET __attribute__((target("avx2")))
+    #define KERNELS_HAS_AVX2() __builtin_cpu_supports("avx2")
+#elif defined(__AVX2__)
+    // NOTE: msvc only lets us use avx2 when the whole program is built for it (/arch:AVX2)
+    #include <immintrin.h>
+    #define KERNELS_AVX2
+    #define KERNELS_AVX2_TARGET
+    #define KERNELS_HAS_AVX2() 1
+#endif
+
+// NOTE: the first candidate within the radius is taken with <=, a closer one must be strictly closer so
+// ties keep the lowest index
+static inline bool kernel_nearest_accept(double distance_squared, double best, int best_index) {
+    return best_index == -1 ? distance_squared <= best : distance_squared < best;
+}
+
+// scalar loop over positions[i..n), also finishes the points left over by the vector versions
+static inline int kernel_nearest_from(const v2f *positions, int i, int n, v2f p, double *best, int best_index) {
+    for (; i < n; i++) {
+        double dx = positions[i].x - p.x;
+        double dy = positions[i].y - p.y;
+        double d = dx * dx + dy * dy;
+        if (kernel_nearest_accept(d, *best, best_index)) {
+            *best = d;
+            best_index = i;
+        }
+    }
+    return best_index;
+}
+
+static inline int kernel_in_rect_from(const v2f *positions, int i, int n, v2f min, v2f max, int *out, int count) {
+    for (; i < n; i++) {
+        if (positions[i].x >= min.x && positions[i].x <= max.x && positions[i].y >= min.y && positions[i].y <= max.y) {
+            out[count++] = i;
+        }
+    }
+    return count;
+}
+
+int kernel_nearest_scalar(const v2f *positions, int n, v2f p, double *distance_squared) {
+    return kernel_nearest_from(positions, 0, n, p, distance_squared, -1);
+}
+
+int kernel_in_rect_scalar(const v2f *positions, int n, v2f min, v2f max, int *out) {
+    return kernel_in_rect_from(positions, 0, n, min, max, out, 0);
+}
+
+#ifdef KERNELS_SSE2
+int kernel_nearest_sse2(const v2f *positions, int n, v2f p, double *distance_squared) {
+    double best = *distance_squared;
+    int best_index = -1;
+    __m128d px = _mm_set1_pd(p.x);
+    __m128d py = _mm_set1_pd(p.y);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d a = _mm_loadu_pd(&positions[i].x); // x0 y0
+        __m128d b = _mm_loadu_pd(&positions[i + 1].x); // x1 y1
+        __m128d dx = _mm_sub_pd(_mm_unpacklo_pd(a, b), px);
+        __m128d dy = _mm_sub_pd(_mm_unpackhi_pd(a, b), py);
+        __m128d d = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+        int mask = _mm_movemask_pd(_mm_cmple_pd(d, _mm_set1_pd(best)));
+        if (mask) {
+            double distances[2];
+            _mm_storeu_pd(distances, d);
+            for (int k = 0; k < 2; k++) {
+                if ((mask >> k & 1) && kernel_nearest_accept(distances[k], best, best_index)) {
+                    best = distances[k];
+                    best_index = i + k;
+                }
+            }
+        }
+    }
+    best_index = kernel_nearest_from(positions, i, n, p, &best, best_index);
+    *distance_squared = best;
+    return best_index;
+}
+
+int kernel_in_rect_sse2(const v2f *positions, int n, v2f min, v2f max, int *out) {
+    __m128d min_x = _mm_set1_pd(min.x);
+    __m128d min_y = _mm_set1_pd(min.y);
+    __m128d max_x = _mm_set1_pd(max.x);
+    __m128d max_y = _mm_set1_pd(max.y);
+    int count = 0;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d a = _mm_loadu_pd(&positions[i].x);
+        __m128d b = _mm_loadu_pd(&positions[i + 1].x);
+        __m128d x = _mm_unpacklo_pd(a, b);
+        __m128d y = _mm_unpackhi_pd(a, b);
+        __m128d inside = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(x, min_x), _mm_cmple_pd(x, max_x)),
+                                    _mm_and_pd(_mm_cmpge_pd(y, min_y), _mm_cmple_pd(y, max_y)));
+        int mask = _mm_movemask_pd(inside);
+        if (mask & 1) {
+            out[count++] = i;
+        }
+        if (mask & 2) {
+            out[count++] = i + 1;
+        }
+    }
+    return kernel_in_rect_from(positions, i, n, min, max, out, count);
+}
+#endif
+
+#ifdef KERNELS_AVX2
+// NOTE: after unpacking two loads of 2 points each, lane k holds the point i + kernel_avx2_lane[k]
+static const int kernel_avx2_lane[4] = {0, 2, 1, 3};
+
+KERNELS_AVX2_TARGET
+int kernel_nearest_avx2(const v2f *positions, int n, v2f p, double *distance_squared) {
+    double best = *distance_squared;
+    int best_index = -1;
+    __m256d px = _mm256_set1_pd(p.x);
+    __m256d py = _mm256_set1_pd(p.y);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d a = _mm256_loadu_pd(&positions[i].x); // x0 y0 x1 y1
+        __m256d b = _mm256_loadu_pd(&positions[i + 2].x); // x2 y2 x3 y3
+        __m256d dx = _mm256_sub_pd(_mm256_unpacklo_pd(a, b), px); // x0 x2 x1 x3
+        __m256d dy = _mm256_sub_pd(_mm256_unpackhi_pd(a, b), py);
+        __m256d d = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(d, _mm256_set1_pd(best), _CMP_LE_OQ));
+        if (mask) {
+            double distances[4];
+            _mm256_storeu_pd(distances, d);
+            // NOTE: visits the points in index order so ties keep the lowest index
+            for (int k = 0; k < 4; k++) {
+                int lane = kernel_avx2_lane[k];
+                if ((mask >> lane & 1) && kernel_nearest_accept(distances[lane], best, best_index)) {
+                    best = distances[lane];
+                    best_index = i + k;
+                }
+            }
+        }
+    }
+    best_index = kernel_nearest_from(positions, i, n, p, &best, best_index);
+    *distance_squared = best;
+    return best_index;
+}
+
+KERNELS_AVX2_TARGET
+int kernel_in_rect_avx2(const v2f *positions, int n, v2f min, v2f max, int *out) {
+    __m256d min_x = _mm256_set1_pd(min.x);
+    __m256d min_y = _mm256_set1_pd(min.y);
+    __m256d max_x = _mm256_set1_pd(max.x);
+    __m256d max_y = _mm256_set1_pd(max.y);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d a = _mm256_loadu_pd(&positions[i].x);
+        __m256d b = _mm256_loadu_pd(&positions[i + 2].x);
+        __m256d x = _mm256_unpacklo_pd(a, b);
+        __m256d y = _mm256_unpackhi_pd(a, b);
+        __m256d inside = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(x, min_x, _CMP_GE_OQ), _mm256_cmp_pd(x, max_x, _CMP_LE_OQ)),
+            _mm256_and_pd(_mm256_cmp_pd(y, min_y, _CMP_GE_OQ), _mm256_cmp_pd(y, max_y, _CMP_LE_OQ)));
+        int mask = _mm256_movemask_pd(inside);
+        for (int k = 0; mask && k < 4; k++) {
+            if (mask >> kernel_avx2_lane[k] & 1) {
+                out[count++] = i + k;
+            }
+        }
+    }
+    return kernel_in_rect_from(positions, i, n, min, max, out, count);
+}
+#endif
+
+#ifdef KERNELS_AVX2
+bool kernels_use_avx2(void) {
+    static int supported = -1; // NOTE: -1 until the first call
+    if (supported == -1) {
+        supported = KERNELS_HAS_AVX2() ? 1 : 0;
+    }
+    return supported;
+}
+#endif
+
+// index of the position nearest to `p` whose squared distance is at most *distance_squared, or -1 if there
+// is none, *distance_squared is updated to the distance of the returned one (so several arrays can be
+// searched in a row)
+int kernel_nearest(const v2f *positions, int n, v2f p, double *distance_squared) {
+#ifdef KERNELS_AVX2
+    if (kernels_use_avx2()) {
+        return kernel_nearest_avx2(positions, n, p, distance_squared);
+    }
+#endif
+#ifdef KERNELS_SSE2
+    return kernel_nearest_sse2(positions, n, p, distance_squared);
+#else
+    return kernel_nearest_scalar(positions, n, p, distance_squared);
+#endif
+}
+
+// writes the index of every position inside [min, max] (borders included) to `out` in increasing order,
+// returns how many there are
+// NOTE: `out` needs room for n indices
+int kernel_in_rect(const v2f *positions, int n, v2f min, v2f max, int *out) {
+#ifdef KERNELS_AVX2
+    if (kernels_use_avx2()) {
+        return kernel_in_rect_avx2(positions, n, min, max, out);
+    }
+#endif
+#ifdef KERNELS_SSE2
+    return kernel_in_rect_sse2(positions, n, min, max, out);
+#else
+    return kernel_in_rect_scalar(positions, n, min, max, out);
+#endif
+}
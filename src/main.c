@@ -1,13 +1,6 @@
 #include <GL/gl3w.h>
 #include <GL/gl3w.c>
 #include <GLFW/glfw3.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <math.h>
-#include <assert.h>
-#include <stdbool.h>
-#include <stdint.h>
-#include <string.h>
 
 #ifdef _WIN32
     #undef max
@@ -16,65 +9,179 @@
 #endif
 
 #include "font.h"
-#include "constants.h"
+#include "graph.h"
 
-#define TRUE 1
-#define FALSE 0
-#define max(a, b) (a > b ? a : b)
-#define min(a, b) (a < b ? a : b)
+// per-instance attributes of the instanced circle draw
+typedef struct {
+    GLfloat x, y;
+    GLfloat r, g, b;
+    GLint vertex; // NOTE: used by the shader to look up the flood animation of the vertex
+} circle_instance_t;
 
-#define NUMERIC_TYPE double
-#define TYPE_NAME v2f
-#include "math.c"
-#undef NUMERIC_TYPE
-#undef TYPE_NAME
+typedef struct {
+    GLfloat x, y;
+    GLfloat offset_x, offset_y; // NOTE: divided by the zoom in the shader (arrow heads keep their size on screen)
+    GLfloat r, g, b;
+    GLfloat progress; // how far along the body of the edge the vertex is (0 at the source, 1 at the destination)
+    GLint edge; // NOTE: used by the shader to look up the flood animation of the edge, -1 if it has none
+} edge_vertex_t;
+
+// cached geometry of a single edge, used to skip edges whose endpoints didn't move
+typedef struct {
+    v2f v1, v2; // endpoint positions the geometry was built for
+    v2f middle_point; // where the arrow head (and the weight) goes
+    v2f low, high; // bounding box of the body
+    int orig, dest;
+    int index; // position of the edge among the out-edges of orig
+    bool long_edge; // NOTE: true if the body reaches further than EDGE_CULL_REACH from the middle point
+    bool curved;
+    bool dirty;
+    int first_line_vertex;
+} edge_geometry_t;
+
+// every edge body and arrow head of the graph, stored in a single vertex buffer
+// NOTE: line vertices come first, followed by 3 arrow head vertices per edge
+typedef struct {
+    edge_geometry_t *edges; // in adjacency iteration order
+    int edges_capacity;
+    int num_edges;
+    edge_vertex_t *vertices;
+    int vertices_capacity;
+    int num_line_vertices;
+    int num_vertices;
+    int adjacency_version; // version of the adjacency the layout was built for (-1 means never built)
+    bool full_upload; // NOTE: set when the layout changed, the whole buffer must be reallocated
+    int upload_start; // range of vertices modified since the last upload
+    int upload_end;
+
+    // edges touching every vertex slot, so moving a vertex only regenerates its own edges
+    int *first_out_edge; // out-edges of v are first_out_edge[v] .. first_out_edge[v + 1] - 1
+    int *first_in_edge; // in-edges of v are in_edges[first_in_edge[v] .. first_in_edge[v + 1] - 1]
+    int slots_capacity;
+    int *in_edges;
+    int in_edges_capacity;
+    int *moved_vertices; // vertices moved since the last refresh (see edge_batch_vertex_moved)
+    int num_moved_vertices;
+    int moved_vertices_capacity;
+
+    spatial_grid_t label_grid; // middle point of every edge, indexed by its position in edges
+
+    // culling, see edge_batch_cull
+    int *long_edges; // edges too long to be found through label_grid, tested one by one
+    int num_long_edges;
+    int long_edges_capacity;
+    bool long_edges_dirty; // NOTE: set when the layout changes, edges that move update the list in place
+    int *visible_edges;
+    int num_visible_edges;
+    int visible_edges_capacity;
+    GLuint *visible_indices; // vertices of the visible edges, the line vertices first and then the arrow heads
+    int visible_indices_capacity;
+
+    GLuint vao; // NOTE: visible_indices come from the stream buffer (bound as its element buffer)
+    GLuint vbo;
+} edge_batch_t;
+
+// what the circle shaders need to play the flood animation, only rebuilt when the flood changes (or the
+// vertices it goes through move), the shaders work out the fill of every vertex from the time alone
+typedef struct {
+    GLint *vertices; // first entrance, number of entrances, number of them with the earliest start and end time (as bits) of every vertex slot
+    int vertices_capacity;
+    GLfloat *entrances; // direction towards the father, start time and angle of every entrance
+    int entrances_capacity;
+    GLfloat *edges; // time the flood starts and ends running along every edge (in edge_batch order), -1 if it never does
+    int edges_capacity;
+    int flood_version; // version of the flood the buffers were built for (-1 means never built)
+    int adjacency_version; // version of the adjacency the edge buffer was built for (-1 means never built)
+    int num_circles; // number of vertex slots the buffers were built for
+    bool dirty; // NOTE: set when vertices move, the entrance directions depend on their positions
+    double time; // seconds since the flood started
+    bool paused; // NOTE: the time stops, stepping through the levels (see flood_step) pauses the animation
+
+    GLuint vertices_buffer;
+    GLuint vertices_texture;
+    GLuint entrances_buffer;
+    GLuint entrances_texture;
+    GLuint edges_buffer;
+    GLuint edges_texture;
+} flood_batch_t;
+
+// geometry rebuilt every frame (circle instances, visible edge indices, text quads...) is written to a
+// single ring buffer instead of reallocating a buffer per draw, a fence at the end of every frame tells when
+// the gpu is done reading what the frame wrote so that part of the ring can be written again
+typedef struct {
+    GLsync fence;
+    GLsizeiptr bytes; // NOTE: includes the alignment padding and the gap left when wrapping around
+} stream_frame_t;
 
 typedef struct {
-    //int orig; // NOTE: unused
-    int dest;
-    int weight;
+    GLuint buffer;
+    GLsizeiptr size;
+    GLsizeiptr head; // where the next upload goes
+    GLsizeiptr used; // bytes the gpu may still read, they end at head
+    GLsizeiptr frame_bytes; // bytes taken by the current frame
+    stream_frame_t frames[STREAM_MAX_FRAMES]; // frames in flight, oldest first
+    int num_frames;
+
+    // NOTE: only the bytes actually uploaded, to measure the cpu -> gpu traffic
+    double total_bytes;
+    int total_frames;
+    int num_stalls; // times an upload had to wait for the gpu
+} stream_buffer_t;
 
-    v2f weight_pos_screen;
-} edge_t;
+typedef struct {
+    GLfloat x, y, z;
+    GLfloat s, t;
+    GLfloat r, g, b;
+} font_vertex_t;
 
+// glyph quads of every text pushed since the last flush, drawn with a single call
 typedef struct {
-    int weight;
-    v2f pos;
-    bool selected;
-    edge_t *children;
-    int num_children;
-
-    int filled; // 0 means not found, 1 means filling, 2 means filled
-    int16_t fill_entrance_index[MAX_VERTEX_ENTRANCES]; // index of the "father"
-    float fill_radius[MAX_VERTEX_ENTRANCES];
-    int num_fill_entrances;
-} vertex_t;
+    font_vertex_t *vertices;
+    int num_vertices;
+    int capacity;
+
+    stbtt_bakedchar cdata[96]; // ASCII alphanumeric range
+    GLuint ftex;
+    GLuint program;
+    GLuint vao; // NOTE: the vertices come from the stream buffer
+} font_batch_t;
 
 typedef struct {
     GLfloat zoom;
     double delta_time;
     bool dragging_map;
-    bool dragging_vertex;
+    int dragging_vertex; // NOTE: -1 means no vertex is currently being dragged (every selected vertex follows it)
+    int *dragged_vertices; // the selection when the drag started, so a frame only visits what moves
+    int num_dragged_vertices;
+    int dragged_vertices_capacity;
+    bool selecting_box; // NOTE: shift + left button, selects every vertex inside the box when released
+    v2f box_start; // corner where the selection box started (world space)
+    int *box_selection; // scratch for graph_vertices_in_rect
+    int box_selection_capacity;
     int modifying_vertex; // NOTE: -1 means no vertex is currently being modified
     v2f last_mouse;
     v2f last_translation;
     v2f cur_translation;
-    vertex_t *circles;
-    int num_circles;
+    graph_t graph; // vertices, edges and the flood animation (see graph.c)
     int editing_circle; // NOTE: -1 means no vertex is currently being edited (weight)
-    edge_t *editing_edge; // NOTE: NULL means no edge is currently being edited
+    int editing_edge_orig; // NOTE: -1 means no edge is currently being edited (weight)
+    int editing_edge_dest;
     // NOTE: a edge and a circle can't both be edited at the same time
     char temp_weight_str[10];
     bool showing_menu;
-
-    int current_animation_root; // index of the current animation root vertex
+    export_job_t *export_job; // NOTE: NULL means no export is running
 
     GLuint default_vao;
-    GLuint edge_vao;
-    GLuint edge_vbo;
-    GLuint font_vao;
-    GLuint font_vbo; // we should probably cache this
+    GLuint circle_instance_vao;
+    circle_instance_t *circle_instances; // NOTE: rebuilt and streamed every frame
+    int circle_instances_capacity;
+    int *visible_vertices; // NOTE: vertices inside the view, found every frame (same capacity as circle_instances)
+    flood_batch_t flood_batch;
+    GLuint edge_vao; // NOTE: only used by the edge being created and the selection box, every other edge lives in edge_batch
+    edge_batch_t edge_batch;
+    font_batch_t font_batch;
     GLuint menu_vao;
+    stream_buffer_t stream; // every per-frame upload goes through here
 } global_state_t;
 
 // kills game with an error message
@@ -104,27 +211,23 @@ char *load_text_file_content(char *filename) {
     return buffer;
 }
 
+// copies the graph and starts writing it to `filename` in the background (see exporter.c)
 void export(global_state_t *global_state, char *filename) {
-    FILE *f = fopen(filename, "w");
-    assert(f);
-    int count_edges = 0;
-    for (int i = 0; i < global_state->num_circles; i++) {
-        count_edges += global_state->circles[i].num_children;
-    }
-    fprintf(f, "%d %d\n", global_state->num_circles, count_edges);
-    for (int i = 0; i < global_state->num_circles; i++) {
-        int x = (int) (global_state->circles[i].pos.x * 4);
-        int y = (int) (global_state->circles[i].pos.y * 4);
-        fprintf(f, "%d %d %d %d\n", i, x, y, global_state->circles[i].weight);
-    }
-    for (int i = 0; i < global_state->num_circles; i++) {
-        for (int j = 0; j < global_state->circles[i].num_children; j++) {
-            edge_t edge = global_state->circles[i].children[j];
-            fprintf(f, "%d %d %d\n", i, edge.dest, edge.weight);
-        }
+    if (global_state->export_job) {
+        fprintf(stderr, "An export is already running\n");
+        return;
     }
-    fprintf(f, "%d\n", rand() % global_state->num_circles);
-    fclose(f);
+    global_state->export_job = graph_export(&global_state->graph, filename);
+}
+
+// joins the export job once it is done and reports how it went, `wait` blocks until then
+void export_poll(global_state_t *global_state, bool wait) {
+    export_job_t *job = global_state->export_job;
+    if (!job || (!export_job_done(job) && !wait)) {
+        return;
+    }
+    export_job_finish(job);
+    global_state->export_job = NULL;
 }
 
 GLuint initialize_shader(char *vertex_file_name, char *frag_file_name) {
@@ -148,6 +251,7 @@ GLuint initialize_shader(char *vertex_file_name, char *frag_file_name) {
         force_quit(output);
     }
     glCompileShader(frag_shader);
+    glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &shader_compiled);
     if (shader_compiled != GL_TRUE) {
         GLchar message[1000];
         glGetShaderInfoLog(frag_shader, 999, NULL, message);
@@ -166,7 +270,7 @@ GLuint initialize_shader(char *vertex_file_name, char *frag_file_name) {
     glGetProgramiv(shader_program, GL_LINK_STATUS, &program_linked);
     if (program_linked != GL_TRUE) {
         GLchar message[1000];
-        glGetProgramInfoLog(program_linked, 999, NULL, message);
+        glGetProgramInfoLog(shader_program, 999, NULL, message);
         char output[1200];
         sprintf(output, "Program failed to link\n%s\n", message);
         force_quit(output);
@@ -175,7 +279,94 @@ GLuint initialize_shader(char *vertex_file_name, char *frag_file_name) {
     return shader_program;
 }
 
-void font_render_text_horrible(GLuint font_shader_program, int vbo, int vao, stbtt_bakedchar *cdata, int ftex, float x, float y, char *text, float r, float g, float b, bool centered) {
+void stream_init(stream_buffer_t *stream, GLsizeiptr size) {
+    memset(stream, 0, sizeof(*stream));
+    stream->size = size;
+    glGenBuffers(1, &stream->buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// forgets the oldest frame in flight, `wait` blocks until the gpu is done with it, otherwise it is only
+// forgotten if the gpu is already done, returns whether it was
+bool stream_release_frame(stream_buffer_t *stream, bool wait) {
+    assert(stream->num_frames);
+    stream_frame_t *frame = &stream->frames[0];
+    GLenum status = glClientWaitSync(frame->fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        if (!wait) {
+            return false;
+        }
+        stream->num_stalls++;
+        do {
+            status = glClientWaitSync(frame->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // NOTE: 1 s
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+    assert(status != GL_WAIT_FAILED);
+    glDeleteSync(frame->fence);
+    stream->used -= frame->bytes;
+    stream->num_frames--;
+    memmove(&stream->frames[0], &stream->frames[1], stream->num_frames * sizeof(*stream->frames));
+    return true;
+}
+
+// copies `data` to the stream buffer and returns its offset inside it (a multiple of `alignment`), the data
+// stays there until the gpu is done with the current frame
+// NOTE: uses an unsynchronized map, the fences already tell which part of the ring the gpu may still read
+GLintptr stream_upload(stream_buffer_t *stream, const void *data, GLsizeiptr size, GLsizeiptr alignment) {
+    GLsizeiptr padding = (alignment - stream->head % alignment) % alignment;
+    if (stream->head + padding + size > stream->size) {
+        padding = stream->size - stream->head; // NOTE: wraps around, the end of the ring is wasted
+    }
+    while (stream->used + padding + size > stream->size && stream->num_frames) {
+        stream_release_frame(stream, true);
+    }
+    if (stream->used + padding + size > stream->size) {
+        // NOTE: the current frame alone doesn't fit, orphans the storage for a bigger one (the draws that
+        // already read from the old one still see it)
+        stream->size = max(size, 2 * stream->size);
+        stream->head = 0;
+        stream->used = 0;
+        stream->frame_bytes = 0;
+        padding = 0;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, stream->size, NULL, GL_STREAM_DRAW);
+    }
+
+    GLintptr offset = (stream->head + padding) % stream->size;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+    void *dest = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+                                  GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    assert(dest);
+    memcpy(dest, data, size);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    stream->head = offset + size;
+    stream->used += padding + size;
+    stream->frame_bytes += padding + size;
+    stream->total_bytes += size;
+    return offset;
+}
+
+// fences everything the current frame uploaded, call it once per frame after the last draw
+void stream_end_frame(stream_buffer_t *stream) {
+    while (stream->num_frames && stream_release_frame(stream, false)) {
+    }
+    if (stream->num_frames == STREAM_MAX_FRAMES) {
+        stream_release_frame(stream, true);
+    }
+    stream->frames[stream->num_frames].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stream->frames[stream->num_frames].bytes = stream->frame_bytes;
+    stream->num_frames++;
+    stream->frame_bytes = 0;
+    stream->total_frames++;
+}
+
+// appends the quads of `text` to the batch, they are only drawn on the next font_flush
+void font_push_text(font_batch_t *batch, float x, float y, char *text, float r, float g, float b, bool centered) {
+    stbtt_bakedchar *cdata = batch->cdata;
     if (centered) {
         char *aux = text;
         float x_off = 0, y_off = 0;
@@ -192,23 +383,19 @@ void font_render_text_horrible(GLuint font_shader_program, int vbo, int vao, stb
     x -= DEFAULT_SCREEN_WIDTH / 2;
     y = DEFAULT_SCREEN_HEIGHT / 2 - y;
 
-    // TODO: clean all of this up
+    int needed = batch->num_vertices + 6 * strlen(text);
+    if (needed > batch->capacity) {
+        batch->capacity = max(needed, 2 * batch->capacity);
+        batch->vertices = realloc(batch->vertices, batch->capacity * sizeof(*batch->vertices));
+        assert(batch->vertices);
+    }
+
     // assuming orthographic projection with units = screen pixels, origin at top left
-    glEnable(GL_TEXTURE_2D);
-    glUseProgram(font_shader_program);
-    glUniform1i(glGetUniformLocation(font_shader_program, "tex"), 0);
-    glUniform1f(glGetUniformLocation(font_shader_program, "window_width"), DEFAULT_SCREEN_WIDTH);
-    glUniform1f(glGetUniformLocation(font_shader_program, "window_height"), DEFAULT_SCREEN_HEIGHT);
-    glUniform3f(glGetUniformLocation(font_shader_program, "color"), r, g, b);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     while (*text) {
-        if (*text >= 32 && *text < 128) {
+        if (*text >= 32 && (unsigned char) *text < 128) {
             stbtt_aligned_quad q;
             stbtt_GetBakedQuad(cdata, 512, 512, *text-32, &x, &y, &q, 1);
             stbtt_bakedchar baked_char = cdata[*text - 32]; // TODO: remove this magic number
-            //printf("%f %f %f %f %f\n", q.x0, q.y0, q.x1, q.y1, baked_char.yoff);
             if (*text == 'e' || *text == 'a' || *text == 'd' || *text == 'o' || *text == 'u' || *text == 's'
                     || *text == 'c' || *text == 't' || *text == '/' || *text == 'C' || *text == 'S'
                     || *text == 'O' || *text == 'U' || *text == '3' || *text == '5') {
@@ -218,90 +405,40 @@ void font_render_text_horrible(GLuint font_shader_program, int vbo, int vao, stb
                 baked_char.yoff += 4.0f;
             }
 
-            float buffer[6 * 5] = {
-                q.x0, q.y0-baked_char.yoff, -0.4, q.s0, q.t1,
-                q.x1, q.y0-baked_char.yoff, -0.4, q.s1, q.t1,
-                q.x0, q.y1-baked_char.yoff, -0.4, q.s0, q.t0,
-                q.x1, q.y0-baked_char.yoff, -0.4, q.s1, q.t1,
-                q.x1, q.y1-baked_char.yoff, -0.4, q.s1, q.t0,
-                q.x0, q.y1-baked_char.yoff, -0.4, q.s0, q.t0
+            font_vertex_t quad[6] = {
+                {q.x0, q.y0-baked_char.yoff, -0.4, q.s0, q.t1, r, g, b},
+                {q.x1, q.y0-baked_char.yoff, -0.4, q.s1, q.t1, r, g, b},
+                {q.x0, q.y1-baked_char.yoff, -0.4, q.s0, q.t0, r, g, b},
+                {q.x1, q.y0-baked_char.yoff, -0.4, q.s1, q.t1, r, g, b},
+                {q.x1, q.y1-baked_char.yoff, -0.4, q.s1, q.t0, r, g, b},
+                {q.x0, q.y1-baked_char.yoff, -0.4, q.s0, q.t0, r, g, b}
             };
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, ftex);
-
-            glBindVertexArray(vao);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo);
-            // NOTE: OpenGL hack (Buffer Object Streaming) to improve performance
-            glBufferData(GL_ARRAY_BUFFER, sizeof(buffer), NULL, GL_STREAM_DRAW);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(buffer), buffer, GL_STREAM_DRAW);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-
-            glBindVertexArray(0);
+            memcpy(&batch->vertices[batch->num_vertices], quad, sizeof(quad));
+            batch->num_vertices += 6;
         }
         text++;
     }
 }
 
-void clear_flood(global_state_t *global_state) {
-    vertex_t *circles = global_state->circles;
-    for (int i = 0; i < global_state->num_circles; i++) {
-        circles[i].filled = 0;
-        circles[i].num_fill_entrances = 0;
-        memset(circles[i].fill_radius, 0, sizeof(circles[i].fill_radius));
+// draws every text pushed since the last flush
+// NOTE: the uniforms of the font program are set once at startup
+void font_flush(font_batch_t *batch, stream_buffer_t *stream) {
+    if (!batch->num_vertices) {
+        return;
     }
-}
 
-void BFS(global_state_t *global_state, int root_index) {
-    clear_flood(global_state);
-    vertex_t *circles = global_state->circles;
-
-    circles[root_index].filled = 1;
-    circles[root_index].fill_entrance_index[circles[root_index].num_fill_entrances++] = root_index;
-    global_state->current_animation_root = root_index;
-    int *visited = calloc(MAX_VERTICES, sizeof(*visited));
-
-    int *queue = calloc(MAX_VERTICES, sizeof(*queue));
-    int queue_start = 0;
-    int queue_end = 0;
-    queue[queue_end++] = root_index;
-    visited[root_index] = 1;
-    while (queue_start < queue_end) {
-        int node = queue[queue_start++];
-
-        // used for animation
-        if (visited[node] == 2) {
-            break;
-        }
-        visited[node] = 2;
+    glUseProgram(batch->program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, batch->ftex);
 
-        for (int i = 0; i < circles[node].num_children; i++) {
-            int children_index = circles[node].children[i].dest;
-#if 1
-            // multi_entrance animation enabled
+    // NOTE: aligned to whole vertices so the draw can start at one
+    GLintptr offset = stream_upload(stream, batch->vertices, batch->num_vertices * sizeof(*batch->vertices),
+                                    sizeof(*batch->vertices));
+    glBindVertexArray(batch->vao);
+    glDrawArrays(GL_TRIANGLES, offset / sizeof(*batch->vertices), batch->num_vertices);
+    glBindVertexArray(0);
 
-            if (!visited[children_index]) { // used for animation
-                queue[queue_end++] = children_index;
-                visited[children_index] = 1;
-            }
-            if (visited[children_index] != 2) {
-                circles[children_index].filled = 1;
-                circles[children_index].fill_entrance_index[circles[children_index].num_fill_entrances++] = node;
-            }
-#else
-            // multi_entrance animation disabled
-
-            if (!visited[children_index]) { // NOTE: disabled for animation
-                queue[queue_end++] = children_index;
-                visited[children_index] = 1;
-                circles[children_index].filled = 1;
-                circles[children_index].fill_entrance_index[circles[children_index].num_fill_entrances++] = node;
-            }
-#endif
-        }
-    }
-    free(visited);
-    free(queue);
+    batch->num_vertices = 0;
 }
 
 v2f get_untranslated_world_space(GLFWwindow *window, double zoom, v2f v) {
@@ -324,47 +461,253 @@ v2f get_cursor_world_space(GLFWwindow *window, v2f translation, double zoom) {
     return r;
 }
 
-void create_vertex(global_state_t *global_state, v2f p, int weight) {
-    vertex_t v;
-    v.weight = weight;
-    v.pos = p;
-    v.selected = FALSE;
-    v.children = malloc(MAX_VERTICES * sizeof(*v.children));
-    v.num_children = 0;
-    v.filled = 0;
-    v.num_fill_entrances = 0;
-    global_state->circles[global_state->num_circles++] = v;
+// deletes the vertex and forgets it in every piece of ui state that references it
+void delete_vertex(global_state_t *global_state, int index) {
+    global_state->dragging_vertex = -1;
+    if (global_state->editing_circle == index) {
+        global_state->editing_circle = -1;
+    }
+    if (global_state->editing_edge_orig == index || global_state->editing_edge_dest == index) {
+        global_state->editing_edge_orig = -1;
+        global_state->editing_edge_dest = -1;
+    }
+    if (global_state->modifying_vertex == index) {
+        global_state->modifying_vertex = -1;
+    }
+
+    graph_delete_vertex(&global_state->graph, index);
 }
 
-void delete_vertex(global_state_t *global_state, int index) {
-    clear_flood(global_state);
-
-    global_state->dragging_vertex = FALSE;
-    for (int i = 0; i < global_state->num_circles; i++) {
-        int removed_location = -1;
-        for (int j = 0; j < global_state->circles[i].num_children; j++) {
-            if (global_state->circles[i].children[j].dest == index) {
-                assert(removed_location == -1);
-                removed_location = j;
-            } else if (global_state->circles[i].children[j].dest > index) {
-                global_state->circles[i].children[j].dest--;
+// returns the edge whose weight is currently being edited, or NULL if there is none
+edge_t *get_editing_edge(global_state_t *global_state) {
+    if (global_state->editing_edge_orig == -1) {
+        return NULL;
+    }
+    return adjacency_find_edge(&global_state->graph.adjacency, global_state->editing_edge_orig, global_state->editing_edge_dest);
+}
+
+// what the command line asked for besides the graph itself
+typedef struct {
+    bool headless;
+    int bfs_root; // NOTE: -1 means no BFS
+    char *levels_filename; // NOTE: NULL means the BFS levels are not written
+    char *export_filename;
+} command_line_t;
+
+// handles the command line, loading or generating the graph right away and filling `command_line` with the
+// rest, returns false if no graph was loaded or generated
+//     FILE            graph exported with E or snapshot saved with S
+//     --complete N    complete graph with N vertices
+//     --bipartite A B complete bipartite graph with A and B vertices
+//     --random N P    random graph with N vertices where each edge exists with probability P
+//     --grid W H      W x H grid graph
+//     --headless      run the commands below and quit without opening a window
+//     --bfs ROOT      BFS from vertex ROOT (starts the flood animation when not headless)
+//     --levels FILE   write the level of every vertex found by --bfs to FILE
+//     --threads N     run BFS on N threads (only the big levels are split)
+//     --export FILE   export the graph (in the format written by E) to FILE
+bool parse_arguments(global_state_t *global_state, command_line_t *command_line, int argc, char **argv) {
+    v2f origin = create_v2f(0, 0);
+    int num_vertices = global_state->graph.adjacency.num_vertices;
+    command_line->headless = false;
+    command_line->bfs_root = -1;
+    command_line->levels_filename = NULL;
+    command_line->export_filename = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--headless")) {
+            command_line->headless = true;
+        } else if (!strcmp(argv[i], "--bfs") && i + 1 < argc) {
+            command_line->bfs_root = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--levels") && i + 1 < argc) {
+            command_line->levels_filename = argv[++i];
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            bfs_set_threads(&global_state->graph.bfs, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--export") && i + 1 < argc) {
+            command_line->export_filename = argv[++i];
+        } else if (!strcmp(argv[i], "--complete") && i + 1 < argc) {
+            int n = atoi(argv[++i]);
+            int *slots = graph_create_vertices(&global_state->graph, n, max((int) ceil(sqrt(n)), 1), origin);
+            if (slots) {
+                free(slots);
+                graph_generate_complete(&global_state->graph);
+            }
+        } else if (!strcmp(argv[i], "--bipartite") && i + 2 < argc) {
+            int a = atoi(argv[++i]);
+            int b = atoi(argv[++i]);
+            graph_generate_complete_bipartite(&global_state->graph, a, b, origin);
+        } else if (!strcmp(argv[i], "--random") && i + 2 < argc) {
+            int n = atoi(argv[++i]);
+            double p = atof(argv[++i]);
+            graph_generate_random(&global_state->graph, n, p, origin);
+        } else if (!strcmp(argv[i], "--grid") && i + 2 < argc) {
+            int w = atoi(argv[++i]);
+            int h = atoi(argv[++i]);
+            graph_generate_grid(&global_state->graph, w, h, origin);
+        } else if (argv[i][0] != '-') {
+            if (graph_is_snapshot(argv[i])) {
+                graph_view_t view;
+                if (!graph_load_snapshot(&global_state->graph, argv[i], &view)) {
+                    exit(-1);
+                }
+                if (view.has_view) {
+                    global_state->zoom = view.zoom;
+                    global_state->last_translation = view.translation;
+                    global_state->cur_translation = create_v2f(0, 0);
+                }
+            } else if (!graph_load(&global_state->graph, argv[i])) {
+                exit(-1);
             }
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", argv[i]);
+            fprintf(stderr, "Usage: %s [FILE] [--complete N] [--bipartite A B] [--random N P] [--grid W H]\n"
+                            "       [--headless] [--bfs ROOT] [--levels FILE] [--threads N] [--export FILE]\n", argv[0]);
+            exit(-1);
+        }
+    }
+    return global_state->graph.adjacency.num_vertices != num_vertices;
+}
+
+// runs the commands given on the command line (after the graph was loaded)
+void run_commands(global_state_t *global_state, command_line_t *command_line) {
+    if (command_line->bfs_root != -1) {
+        int root = command_line->bfs_root;
+        if (!adjacency_is_vertex(&global_state->graph.adjacency, root)) {
+            fprintf(stderr, "Invalid BFS root: %d\n", root);
+            exit(-1);
+        }
+        double start = wall_clock();
+        bfs_t *bfs = graph_bfs(&global_state->graph, root);
+        double seconds = wall_clock() - start;
+        printf("bfs from %d: reached %d of %d vertices, depth %d (%d levels bottom-up), %d threads, %.3f ms\n", root,
+               bfs->num_reached, global_state->graph.adjacency.num_vertices, bfs->depth, bfs->num_bottom_up_levels,
+               bfs->num_threads, seconds * 1000);
+        if (!command_line->headless) {
+            graph_flood(&global_state->graph, root);
         }
-        if (removed_location != -1) {
-            for (int j = removed_location + 1; j < global_state->circles[i].num_children; j++) {
-                global_state->circles[i].children[j-1] = global_state->circles[i].children[j];
+
+        if (command_line->levels_filename) {
+            // one "vertex level" line per vertex
+            FILE *f = fopen(command_line->levels_filename, "w");
+            if (!f) {
+                fprintf(stderr, "Could not open %s\n", command_line->levels_filename);
+                exit(-1);
+            }
+            for (int i = 0; i < global_state->graph.num_circles; i++) {
+                if (adjacency_is_vertex(&global_state->graph.adjacency, i)) {
+                    fprintf(f, "%d %d\n", i, bfs->levels[i]);
+                }
+            }
+            // NOTE: fprintf errors stick to the stream, so they are only checked once at the end
+            bool ok = !ferror(f);
+            ok = !fclose(f) && ok;
+            if (!ok) {
+                fprintf(stderr, "Could not write %s\n", command_line->levels_filename);
+                exit(-1);
             }
-            global_state->circles[i].num_children--;
         }
     }
+    if (command_line->export_filename) {
+        export(global_state, command_line->export_filename);
+        if (command_line->headless) {
+            export_poll(global_state, true);
+        }
+    }
+}
 
-    free(global_state->circles[index].children);
-    for (int i = index + 1; i < global_state->num_circles; i++) {
-        global_state->circles[i-1] = global_state->circles[i];
+// runs the command line without glfw or opengl, only the graph part of the global state is initialized
+int headless_main(int argc, char **argv) {
+    global_state_t global_state;
+    memset(&global_state, 0, sizeof(global_state));
+    graph_init(&global_state.graph);
+    global_state.modifying_vertex = -1;
+    global_state.dragging_vertex = -1;
+    global_state.editing_circle = -1;
+    global_state.editing_edge_orig = -1;
+    global_state.editing_edge_dest = -1;
+
+    command_line_t command_line;
+    parse_arguments(&global_state, &command_line, argc, argv);
+    run_commands(&global_state, &command_line);
+    // NOTE: also joins the BFS threads started by --threads
+    graph_destroy(&global_state.graph);
+    return 0;
+}
+
+// returns the vertex under `pos` (world space), or -1 if there is none
+int find_vertex_at(global_state_t *global_state, v2f pos) {
+    return grid_find_nearest(&global_state->graph.vertex_grid, pos, 1.0f /* radius */);
+}
+
+typedef struct {
+    global_state_t *global_state;
+    v2f screen_pos;
+    edge_geometry_t *nearest;
+    double nearest_distance_squared;
+} edge_weight_query_t;
+
+void edge_weight_query_callback(void *data, int id, v2f entry_pos) {
+    edge_weight_query_t *query = data;
+    edge_geometry_t *geometry = &query->global_state->edge_batch.edges[id];
+    edge_t *edge = adjacency_find_edge(&query->global_state->graph.adjacency, geometry->orig, geometry->dest);
+    assert(edge);
+
+    v2f p = sub_v2f(edge->weight_pos_screen, query->screen_pos);
+    double distance_squared = p.x * p.x + p.y * p.y;
+    double r = FONT_SIZE;
+    if (distance_squared <= r * r && (!query->nearest || distance_squared < query->nearest_distance_squared)) {
+        query->nearest = geometry;
+        query->nearest_distance_squared = distance_squared;
     }
-    global_state->num_circles--;
-    global_state->editing_circle = -1;
-    global_state->editing_edge = NULL;
+}
+
+// finds the edge whose weight is drawn under the cursor, returns false if there is none
+bool find_edge_weight_at_cursor(GLFWwindow *window, global_state_t *global_state, int *orig, int *dest) {
+    edge_batch_t *batch = &global_state->edge_batch;
+    if (batch->adjacency_version != global_state->graph.adjacency.version) {
+        // NOTE: the edges changed since the last frame, so no weight has been drawn for them yet
+        return false;
+    }
+
+    edge_weight_query_t query = {global_state, create_v2f(0, 0), NULL, 0};
+    glfwGetCursorPos(window, &query.screen_pos.x, &query.screen_pos.y);
+    v2f world_pos = get_cursor_world_space(window, global_state->last_translation, global_state->zoom);
+
+    // the weight is drawn FONT_SIZE * 1.1 pixels away from the middle point of the edge (which is what
+    // the grid stores) and can be picked from FONT_SIZE pixels away from there
+    double pixels_per_unit = global_state->zoom * (DEFAULT_SCREEN_WIDTH / 2);
+    double radius = (FONT_SIZE * 1.1f + FONT_SIZE) / pixels_per_unit;
+    grid_query_radius(&batch->label_grid, world_pos, radius, edge_weight_query_callback, &query);
+    if (!query.nearest) {
+        return false;
+    }
+    *orig = query.nearest->orig;
+    *dest = query.nearest->dest;
+    return true;
+}
+
+// pauses the flood animation at the end of the next level (direction 1) or goes back to the end of the
+// previous one (direction -1)
+// NOTE: the animation is a function of the time alone (see flood_batch_refresh), so this is just a seek
+void flood_step(global_state_t *global_state, int direction) {
+    graph_t *graph = &global_state->graph;
+    flood_batch_t *flood = &global_state->flood_batch;
+    if (graph->current_animation_root == -1) {
+        return;
+    }
+    flood->paused = true;
+
+    // NOTE: level 0 ends when the root is filled, "step" n is the end of level n - 1 (0 is the start)
+    int step = graph_flood_levels_at(graph, flood->time);
+    double step_time = step ? graph_flood_level_end(step - 1) : 0;
+    if (direction > 0) {
+        step++;
+    } else if (flood->time <= step_time) {
+        step--;
+    }
+    if (step < 0 || step > graph->flood_depth + 1) {
+        return;
+    }
+    flood->time = step ? graph_flood_level_end(step - 1) : 0;
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
@@ -385,60 +728,44 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         export(global_state, "output.txt");
     }
 
+    // save a binary snapshot when S is pressed
+    if (key == GLFW_KEY_S && action == GLFW_PRESS) {
+        graph_view_t view = {true, global_state->zoom, global_state->last_translation};
+        graph_save_snapshot(&global_state->graph, "output.snapshot", &view);
+    }
+
     // randomize all weights when R is pressed
     if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-        for (int i = 0; i < global_state->num_circles; i++) {
-            global_state->circles[i].weight = rand() % (WEIGHT_RANDOM_LIMIT + 1);
-            for (int j = 0; j < global_state->circles[i].num_children; j++) {
-                global_state->circles[i].children[j].weight = rand() % (WEIGHT_RANDOM_LIMIT + 1);
+        adjacency_t *adj = &global_state->graph.adjacency;
+        for (int i = 0; i < global_state->graph.num_circles; i++) {
+            if (!adjacency_is_vertex(adj, i)) {
+                continue;
+            }
+            global_state->graph.weights[i] = rand() % (WEIGHT_RANDOM_LIMIT + 1);
+            for (int j = 0; j < adjacency_degree(adj, i); j++) {
+                adjacency_edge(adj, i, j)->weight = rand() % (WEIGHT_RANDOM_LIMIT + 1);
             }
         }
     }
 
     // make graph complete when C is pressed
     if (key == GLFW_KEY_C && action == GLFW_PRESS) {
-        for (int i = 0; i < global_state->num_circles; i++) {
-            bool *missing = calloc(global_state->num_circles, sizeof(*missing));
-            for (int j = 0; j < global_state->circles[i].num_children; j++) {
-                missing[global_state->circles[i].children[j].dest] = 1;
-            }
-            for (int j = 0; j < global_state->num_circles; j++) {
-                if (!missing[j] && i != j) {
-                    int cur_num_children = global_state->circles[i].num_children;
-                    global_state->circles[i].children[cur_num_children].dest = j;
-                    global_state->circles[i].children[cur_num_children].weight = 1;
-                    global_state->circles[i].num_children++;
-                }
-            }
-            free(missing);
-        }
+        graph_generate_complete(&global_state->graph);
     }
 
     // create vertex when A is pressed
     if (key == GLFW_KEY_A && action == GLFW_PRESS) {
-        bool found = false;
-        for (int i = 0; i < global_state->num_circles; i++) {
-            v2f p = sub_v2f(global_state->circles[i].pos, cursor_pos);
-            double r = 1.0f;
-            if (p.x * p.x + p.y * p.y <= r * r) {
-                found = true;
-                break;
-            }
-        }
+        bool found = find_vertex_at(global_state, cursor_pos) != -1;
         if (!found) {
-            create_vertex(global_state, cursor_pos, 1);
+            graph_create_vertex(&global_state->graph, cursor_pos, 1);
         }
     }
 
     // delete vertex when D is pressed
     if (key == GLFW_KEY_D && action == GLFW_PRESS) {
-        for (int i = 0; i < global_state->num_circles; i++) {
-            v2f p = sub_v2f(global_state->circles[i].pos, cursor_pos);
-            double r = 1.0f;
-            if (p.x * p.x + p.y * p.y <= r * r) {
-                delete_vertex(global_state, i);
-                break;
-            }
+        int vertex = find_vertex_at(global_state, cursor_pos);
+        if (vertex != -1) {
+            delete_vertex(global_state, vertex);
         }
     }
 
@@ -446,40 +773,23 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     {
         if (key == GLFW_KEY_X && action == GLFW_PRESS) {
             global_state->editing_circle = -1;
-            global_state->editing_edge = NULL;
+            global_state->editing_edge_orig = -1;
+            global_state->editing_edge_dest = -1;
 
             // vertex weights
-            bool found = false;
-            for (int i = 0; i < global_state->num_circles && !found; i++) {
-                v2f p = sub_v2f(global_state->circles[i].pos, cursor_pos);
-                double r = 1.0f;
-                if (p.x * p.x + p.y * p.y <= r * r) {
-                    global_state->editing_circle = i;
-                    global_state->temp_weight_str[0] = 0;
-                    found = true;
-                }
+            int vertex = find_vertex_at(global_state, cursor_pos);
+            if (vertex != -1) {
+                global_state->editing_circle = vertex;
+                global_state->temp_weight_str[0] = 0;
             }
             
             // edge weights
-            for (int i = 0; i < global_state->num_circles && !found; i++) {
-                for (int j = 0; j < global_state->circles[i].num_children && !found; j++) {
-                    edge_t *edge = &global_state->circles[i].children[j];
-
-                    v2f screen_space_cursor_pos;
-                    glfwGetCursorPos(window, &screen_space_cursor_pos.x, &screen_space_cursor_pos.y);
-
-                    v2f p = sub_v2f(edge->weight_pos_screen, screen_space_cursor_pos);
-    
-                    double r = FONT_SIZE;
-                    if (p.x * p.x + p.y * p.y <= r * r) {
-                        global_state->editing_edge = edge;
-                        global_state->temp_weight_str[0] = 0;
-                        found = true;
-                    }
-                }
+            if (vertex == -1 && find_edge_weight_at_cursor(window, global_state, &global_state->editing_edge_orig,
+                                                           &global_state->editing_edge_dest)) {
+                global_state->temp_weight_str[0] = 0;
             }
         }
-        if ((global_state->editing_circle != -1 || global_state->editing_edge) && action == GLFW_PRESS) {
+        if ((global_state->editing_circle != -1 || global_state->editing_edge_orig != -1) && action == GLFW_PRESS) {
             if (key >= GLFW_KEY_0 && key <= GLFW_KEY_9) {
                 if (strlen(global_state->temp_weight_str) != 10) {
                     assert(strlen(global_state->temp_weight_str) < 10);
@@ -487,9 +797,9 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
                     temp_str[0] = '0' + key - GLFW_KEY_0;
                     strcat(global_state->temp_weight_str, temp_str);
                     if (global_state->editing_circle != -1) {
-                        global_state->circles[global_state->editing_circle].weight = atoi(global_state->temp_weight_str);
+                        global_state->graph.weights[global_state->editing_circle] = atoi(global_state->temp_weight_str);
                     } else {
-                        global_state->editing_edge->weight = atoi(global_state->temp_weight_str);
+                        get_editing_edge(global_state)->weight = atoi(global_state->temp_weight_str);
                     }
                 }
             }
@@ -501,29 +811,34 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
                     strcpy(global_state->temp_weight_str, "0");
                 }
                 if (global_state->editing_circle != -1) {
-                    global_state->circles[global_state->editing_circle].weight = atoi(global_state->temp_weight_str);
+                    global_state->graph.weights[global_state->editing_circle] = atoi(global_state->temp_weight_str);
                 } else {
-                    global_state->editing_edge->weight = atoi(global_state->temp_weight_str);
+                    get_editing_edge(global_state)->weight = atoi(global_state->temp_weight_str);
                 }
             }
             if (key == GLFW_KEY_ENTER || key == GLFW_KEY_KP_ENTER|| key == GLFW_KEY_ESCAPE) {
                 global_state->editing_circle = -1;
-                global_state->editing_edge = NULL;
+                global_state->editing_edge_orig = -1;
+                global_state->editing_edge_dest = -1;
             }
         }
     }
 
     // run BFS when B is pressed
     if (key == GLFW_KEY_B && action == GLFW_PRESS) {
-        for (int i = 0; i < global_state->num_circles; i++) {
-            v2f p = sub_v2f(global_state->circles[i].pos, cursor_pos);
-            double r = 1.0f;
-            if (p.x * p.x + p.y * p.y <= r * r) {
-                BFS(global_state, i);
-                break;
-            }
+        int vertex = find_vertex_at(global_state, cursor_pos);
+        if (vertex != -1) {
+            graph_flood(&global_state->graph, vertex);
         }
     }
+
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+        global_state->flood_batch.paused = !global_state->flood_batch.paused;
+    }
+
+    if ((key == GLFW_KEY_LEFT || key == GLFW_KEY_RIGHT) && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
+        flood_step(global_state, key == GLFW_KEY_RIGHT ? 1 : -1);
+    }
 }
 
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
@@ -537,58 +852,70 @@ void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
     if (button == GLFW_MOUSE_BUTTON_1 && action == GLFW_PRESS) {
         // handle adding dependencies
         if (mods & GLFW_MOD_CONTROL) {
-            global_state->modifying_vertex = -1; // unselect vertices
-            for (int i = 0; i < global_state->num_circles; i++) {
-                v2f p = sub_v2f(global_state->circles[i].pos, mouse_pos);
-                double r = 1.0f;
-                if (p.x * p.x + p.y * p.y <= r * r) {
-                    global_state->modifying_vertex = i;
-                    break;
-                }
-            }
+            global_state->modifying_vertex = find_vertex_at(global_state, mouse_pos); // -1 unselects vertices
         }
     }
 
     // handle vertice selection and dragging
     {
         if (button == GLFW_MOUSE_BUTTON_1 && action == GLFW_PRESS && !mods) {
-            global_state->dragging_vertex = TRUE;
-            for (int i = 0; i < global_state->num_circles; i++) {
-                global_state->circles[i].selected = false;
+            int vertex = find_vertex_at(global_state, mouse_pos);
+            // NOTE: grabbing a vertex that is already selected drags the whole selection
+            if (vertex == -1 || !global_state->graph.selected[vertex]) {
+                memset(global_state->graph.selected, 0, global_state->graph.num_circles * sizeof(bool));
+                if (vertex != -1) {
+                    global_state->graph.selected[vertex] = true;
+                }
             }
-            for (int i = 0; i < global_state->num_circles; i++) {
-                v2f p = sub_v2f(global_state->circles[i].pos, mouse_pos);
-                double r = 1.0f;
-                if (p.x * p.x + p.y * p.y <= r * r) {
-                    global_state->circles[i].selected = true;
-                    break;
+            global_state->dragging_vertex = vertex;
+            global_state->num_dragged_vertices = 0;
+            for (int i = 0; vertex != -1 && i < global_state->graph.num_circles; i++) {
+                if (!global_state->graph.selected[i]) {
+                    continue;
                 }
+                if (global_state->num_dragged_vertices == global_state->dragged_vertices_capacity) {
+                    int capacity = max(64, 2 * global_state->dragged_vertices_capacity);
+                    global_state->dragged_vertices = realloc(global_state->dragged_vertices, capacity * sizeof(int));
+                    assert(global_state->dragged_vertices);
+                    global_state->dragged_vertices_capacity = capacity;
+                }
+                global_state->dragged_vertices[global_state->num_dragged_vertices++] = i;
+            }
+        }
+
+        if (button == GLFW_MOUSE_BUTTON_1 && action == GLFW_PRESS && mods == GLFW_MOD_SHIFT) {
+            global_state->selecting_box = true;
+            global_state->box_start = mouse_pos;
+        }
+
+        if (button == GLFW_MOUSE_BUTTON_1 && action == GLFW_RELEASE && global_state->selecting_box) {
+            global_state->selecting_box = false;
+            graph_t *graph = &global_state->graph;
+            if (graph->num_circles > global_state->box_selection_capacity) {
+                global_state->box_selection_capacity = max(graph->num_circles, 2 * global_state->box_selection_capacity);
+                global_state->box_selection = realloc(global_state->box_selection,
+                                                      global_state->box_selection_capacity * sizeof(int));
+                assert(global_state->box_selection);
+            }
+            int count = graph_vertices_in_rect(graph, global_state->box_start, mouse_pos, global_state->box_selection);
+            memset(graph->selected, 0, graph->num_circles * sizeof(bool));
+            for (int i = 0; i < count; i++) {
+                graph->selected[global_state->box_selection[i]] = true;
             }
         }
 
         if (button == GLFW_MOUSE_BUTTON_1 && action == GLFW_RELEASE) {
-            global_state->dragging_vertex = FALSE;
+            global_state->dragging_vertex = -1;
             if (global_state->modifying_vertex != -1) {
                 int vertex = global_state->modifying_vertex;
-                for (int i = 0; i < global_state->num_circles; i++) {
-                    v2f p = sub_v2f(global_state->circles[i].pos, mouse_pos);
-                    double r = 1.0f;
-                    if (p.x * p.x + p.y * p.y <= r * r) {
-                        // check if vertice doesn't already belong to children
-                        bool is_child_already = false;
-                        for (int j = 0; j < global_state->circles[vertex].num_children; j++) {
-                            if (global_state->circles[vertex].children[j].dest == i) {
-                                is_child_already = true;
-                            }
-                        }
-
-                        if (!is_child_already && vertex != i) {
-                            int cur_num_children = global_state->circles[vertex].num_children;
-                            global_state->circles[vertex].children[cur_num_children].dest = i;
-                            global_state->circles[vertex].children[cur_num_children].weight = 1;
-                            global_state->circles[vertex].num_children++;
-                            break;
-                        }
+                int i = find_vertex_at(global_state, mouse_pos);
+                if (i != -1) {
+                    // check if vertice doesn't already belong to children
+                    adjacency_t *adj = &global_state->graph.adjacency;
+                    bool is_child_already = adjacency_find_edge(adj, vertex, i) != NULL;
+
+                    if (!is_child_already && vertex != i) {
+                        adjacency_add_edge(adj, vertex, i, 1);
                     }
                 }
             }
@@ -620,13 +947,26 @@ void scroll_callback(GLFWwindow *window, double x, double y) {
     global_state->zoom = max(global_state->zoom, 0.04);
 }
 
-// TODO: optimize this, its performance is terrible right now
-void draw_edge(edge_t *edge, int VBO, int VAO, int VBO3, int VAO3, global_state_t *global_state, v2f v1,
-               v2f v2, bool curved, int weight_color_r, int weight_color_g, int weight_color_b,
-               int program_arrow, int program_font, stbtt_bakedchar *cdata, int ftex) {
+void set_edge_vertex(edge_vertex_t *vertex, v2f p, v2f offset, float progress, int edge, const GLfloat *color) {
+    vertex->x = p.x;
+    vertex->y = p.y;
+    vertex->offset_x = offset.x;
+    vertex->offset_y = offset.y;
+    vertex->r = color[0];
+    vertex->g = color[1];
+    vertex->b = color[2];
+    vertex->progress = progress;
+    vertex->edge = edge;
+}
+
+// writes the body (2 * EDGE_CURVE_SEGMENTS vertices if curved, 2 otherwise) and the arrow head (3 vertices)
+// of the edge v1 -> v2, returns the point where the arrow head was placed
+// NOTE: `edge` is the index of the edge inside the edge batch (-1 for edges outside of it)
+v2f build_edge_geometry(v2f v1, v2f v2, bool curved, int edge, const GLfloat *color, edge_vertex_t *lines,
+                        edge_vertex_t *head) {
+    v2f no_offset = create_v2f(0, 0);
 
-    glUseProgram(program_arrow);
-    // draw arrow body
+    // arrow body
 
     v2f middle_point_on_curve;
     if (curved) {
@@ -639,28 +979,27 @@ void draw_edge(edge_t *edge, int VBO, int VAO, int VBO3, int VAO3, global_state_
         middle_point = add_v2f(middle_point, ortho_half_v1v2_origin);
 
         // iterate over bezier curve
+        // NOTE: the progress of every vertex is the length of the curve up to it, divided by the whole length
+        // once it is known
+        edge_vertex_t *first_line = lines;
+        double length = 0;
         v2f last_T = v1;
-        for (int i = 1; i <= 20; i++) {
-            float t = i / 20.0f;
+        for (int i = 1; i <= EDGE_CURVE_SEGMENTS; i++) {
+            float t = i / (float) EDGE_CURVE_SEGMENTS;
             v2f aux1 = scale_v2f(v1, (1 - t) * (1 - t));
             v2f aux2 = scale_v2f(middle_point, 2 * (1 - t) * t);
             v2f aux3 = scale_v2f(v2, t * t);
             v2f T = add_v2f(add_v2f(aux1, aux2), aux3);
 
-            GLfloat line_vertices[3 * 2] = {
-                last_T.x, last_T.y, 0.2,
-                T.x, T.y, 0.2,
-            };
-            glBindVertexArray(VAO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            // NOTE: OpenGL hack (Buffer Object Streaming) to improve performance
-            glBufferData(GL_ARRAY_BUFFER, sizeof(line_vertices), NULL, GL_STREAM_DRAW);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(line_vertices), line_vertices, GL_STATIC_DRAW);
-            glDrawArrays(GL_LINES, 0, 2);
-            glBindVertexArray(0);
+            set_edge_vertex(lines++, last_T, no_offset, length, edge, color);
+            length += magnitude_v2f(sub_v2f(T, last_T));
+            set_edge_vertex(lines++, T, no_offset, length, edge, color);
 
             last_T = T;
         }
+        for (edge_vertex_t *line = first_line; length > 0 && line < lines; line++) {
+            line->progress /= length;
+        }
 
         float t = 0.5f;
         v2f aux1 = scale_v2f(v1, (1 - t) * (1 - t));
@@ -668,95 +1007,529 @@ void draw_edge(edge_t *edge, int VBO, int VAO, int VBO3, int VAO3, global_state_
         v2f aux3 = scale_v2f(v2, t * t);
         middle_point_on_curve = add_v2f(add_v2f(aux1, aux2), aux3);
     } else {
-        GLfloat line_vertices[3 * 2] = {
-            v1.x, v1.y, 0.2,
-            v2.x, v2.y, 0.2,
-        };
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // NOTE: OpenGL hack (Buffer Object Streaming) to improve performance
-        glBufferData(GL_ARRAY_BUFFER, sizeof(line_vertices), NULL, GL_STREAM_DRAW);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(line_vertices), line_vertices, GL_STREAM_DRAW);
-        glDrawArrays(GL_LINES, 0, 2);
-        glBindVertexArray(0);
+        set_edge_vertex(lines++, v1, no_offset, 0, edge, color);
+        set_edge_vertex(lines++, v2, no_offset, 1, edge, color);
+        middle_point_on_curve = add_v2f(v2, scale_v2f(sub_v2f(v1, v2), 0.5f));
     }
 
-    // draw arrow head
+    // arrow head
 
     double magv2v1 = magnitude_v2f(sub_v2f(v1, v2));
     if (magv2v1 > 0.001f) {
         v2f v2v1 = sub_v2f(v1, v2);
-        v2f middle_v2v1 = scale_v2f(v2v1, 0.5f);
-
         v2f normalized_v2v1 = normalize_v2f(v2v1);
-        v2f arrow_head_vector = scale_v2f(normalized_v2v1, ARROW_HEAD_CONSTANT / global_state->zoom);
-
-        if (!curved) {
-            middle_point_on_curve = add_v2f(v2, middle_v2v1);
-        }
+        v2f arrow_head_vector = scale_v2f(normalized_v2v1, ARROW_HEAD_CONSTANT);
 
         v2f p1, p2, p3;
-        p1 = add_v2f(middle_point_on_curve, scale_v2f(arrow_head_vector, -0.5));
-        
-        p2 = add_v2f(middle_point_on_curve,
-                     scale_v2f(create_v2f(-arrow_head_vector.y,
-                                          arrow_head_vector.x),
-                               0.5));
+        p1 = scale_v2f(arrow_head_vector, -0.5);
+
+        p2 = scale_v2f(create_v2f(-arrow_head_vector.y, arrow_head_vector.x), 0.5);
         p2 = add_v2f(p2, scale_v2f(arrow_head_vector, 0.5));
 
-        p3 = add_v2f(middle_point_on_curve,
-                     scale_v2f(create_v2f(arrow_head_vector.y,
-                                          -arrow_head_vector.x),
-                               0.5));
+        p3 = scale_v2f(create_v2f(arrow_head_vector.y, -arrow_head_vector.x), 0.5);
         p3 = add_v2f(p3, scale_v2f(arrow_head_vector, 0.5));
 
-        GLfloat arrow_vertices[3 * 3] = {
-            p2.x, p2.y, 0.2,
-            p1.x, p1.y, 0.2,
-            p3.x, p3.y, 0.2,
-        };
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // NOTE: OpenGL hack (Buffer Object Streaming) to improve performance
-        glBufferData(GL_ARRAY_BUFFER, sizeof(arrow_vertices), NULL, GL_STREAM_DRAW);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(arrow_vertices), arrow_vertices, GL_STREAM_DRAW);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-        glBindVertexArray(0);
+        set_edge_vertex(&head[0], middle_point_on_curve, p2, 0.5f, edge, color);
+        set_edge_vertex(&head[1], middle_point_on_curve, p1, 0.5f, edge, color);
+        set_edge_vertex(&head[2], middle_point_on_curve, p3, 0.5f, edge, color);
+    } else {
+        // NOTE: degenerate triangle, nothing gets drawn
+        for (int i = 0; i < 3; i++) {
+            set_edge_vertex(&head[i], middle_point_on_curve, no_offset, 0.5f, edge, color);
+        }
+    }
+
+    return middle_point_on_curve;
+}
+
+// returns the screen position of the weight of the edge v1 -> v2 (all arguments in translated world space)
+v2f get_edge_weight_pos(global_state_t *global_state, v2f v1, v2f v2, v2f middle_point_on_curve, bool curved) {
+    v2f edge_weight_pos;
+
+    v1.x = (v1.x * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_WIDTH / 2);
+    v1.y = (-v1.y * ASPECT_RATIO * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_HEIGHT / 2);
+    v2.x = (v2.x * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_WIDTH / 2);
+    v2.y = (-v2.y * ASPECT_RATIO * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_HEIGHT / 2);
+    v2f temp_v = scale_v2f(sub_v2f(v2, v1), 0.5f);
+    v2f v3 = scale_v2f(normalize_v2f(create_v2f(-temp_v.y, temp_v.x)), FONT_SIZE*1.1f);
+
+    if (curved) {
+        edge_weight_pos.x = (middle_point_on_curve.x * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_WIDTH / 2);
+        edge_weight_pos.y = (-middle_point_on_curve.y * ASPECT_RATIO * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_HEIGHT / 2);
+        edge_weight_pos = add_v2f(edge_weight_pos, scale_v2f(v3, -1));
+    } else {
+        v2f v4 = add_v2f(v1, temp_v);
+        edge_weight_pos = add_v2f(v3, v4);
+    }
+
+    return edge_weight_pos;
+}
+
+// tells the edge batch that `v` moved, its edges are regenerated on the next edge_batch_refresh
+// NOTE: creating or deleting vertices changes the adjacency, which regenerates every edge anyway
+void edge_batch_vertex_moved(edge_batch_t *batch, int v) {
+    if (batch->num_moved_vertices == batch->moved_vertices_capacity) {
+        batch->moved_vertices_capacity = batch->moved_vertices_capacity ? 2 * batch->moved_vertices_capacity : 64;
+        batch->moved_vertices = realloc(batch->moved_vertices, batch->moved_vertices_capacity * sizeof(int));
+        assert(batch->moved_vertices);
+    }
+    batch->moved_vertices[batch->num_moved_vertices++] = v;
+}
+
+// adds `e` to long_edges (or removes it), keeping the list sorted
+// NOTE: costs as much as the merge edge_batch_cull does with the list every frame, nothing is done while the
+// whole list is going to be rebuilt anyway
+void edge_batch_update_long_edges(edge_batch_t *batch, int e, bool long_edge) {
+    if (batch->long_edges_dirty) {
+        return;
+    }
+    int low = 0;
+    int high = batch->num_long_edges;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (batch->long_edges[middle] < e) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
     }
+    if (long_edge) {
+        if (batch->num_long_edges == batch->long_edges_capacity) {
+            batch->long_edges_capacity = batch->long_edges_capacity ? 2 * batch->long_edges_capacity : 64;
+            batch->long_edges = realloc(batch->long_edges, batch->long_edges_capacity * sizeof(int));
+            assert(batch->long_edges);
+        }
+        memmove(&batch->long_edges[low + 1], &batch->long_edges[low], (batch->num_long_edges - low) * sizeof(int));
+        batch->long_edges[low] = e;
+        batch->num_long_edges++;
+    } else {
+        assert(low < batch->num_long_edges && batch->long_edges[low] == e);
+        memmove(&batch->long_edges[low], &batch->long_edges[low + 1], (batch->num_long_edges - low - 1) * sizeof(int));
+        batch->num_long_edges--;
+    }
+}
 
-    // draw edge weight
+// rebuilds the geometry of edge `e` if it is new or one of its endpoints moved since it was built
+void edge_batch_update_edge(edge_batch_t *batch, v2f *positions, int e) {
+    edge_geometry_t *geometry = &batch->edges[e];
+    v2f v1 = positions[geometry->orig];
+    v2f v2 = positions[geometry->dest];
+    if (!geometry->dirty &&
+        v1.x == geometry->v1.x && v1.y == geometry->v1.y &&
+        v2.x == geometry->v2.x && v2.y == geometry->v2.y) {
+        return;
+    }
+
+    GLfloat color[3] = {ARROW_DEFAULT_COLOR};
+    int first_head_vertex = batch->num_line_vertices + 3 * e;
+    v2f old_middle_point = geometry->middle_point;
+    geometry->v1 = v1;
+    geometry->v2 = v2;
+    geometry->middle_point = build_edge_geometry(v1, v2, geometry->curved, e, color,
+                                                 &batch->vertices[geometry->first_line_vertex],
+                                                 &batch->vertices[first_head_vertex]);
+    if (geometry->dirty) {
+        grid_insert(&batch->label_grid, e, geometry->middle_point);
+    } else {
+        grid_move(&batch->label_grid, e, old_middle_point, geometry->middle_point);
+    }
+    geometry->dirty = false;
+
+    int num_line_vertices = geometry->curved ? 2 * EDGE_CURVE_SEGMENTS : 2;
+    edge_vertex_t *lines = &batch->vertices[geometry->first_line_vertex];
+    geometry->low = geometry->high = create_v2f(lines[0].x, lines[0].y);
+    for (int k = 1; k < num_line_vertices; k++) {
+        geometry->low = create_v2f(min(geometry->low.x, lines[k].x), min(geometry->low.y, lines[k].y));
+        geometry->high = create_v2f(max(geometry->high.x, lines[k].x), max(geometry->high.y, lines[k].y));
+    }
+    v2f reach = sub_v2f(geometry->high, geometry->low);
+    bool long_edge = max(reach.x, reach.y) > EDGE_CULL_REACH;
+    if (long_edge != geometry->long_edge) {
+        geometry->long_edge = long_edge;
+        edge_batch_update_long_edges(batch, e, long_edge);
+    }
+
+    if (geometry->first_line_vertex < batch->upload_start) {
+        batch->upload_start = geometry->first_line_vertex;
+    }
+    if (first_head_vertex + 3 > batch->upload_end) {
+        batch->upload_end = first_head_vertex + 3;
+    }
+}
+
+// brings the edge batch up to date with the graph (CPU side only, see edge_batch_upload)
+// NOTE: the layout is only rebuilt when the edges change, otherwise just the edges of the vertices that
+// moved are regenerated, so a frame where nothing moved costs nothing (the flood animation is played by
+// the edge shaders, see flood_batch_refresh)
+void edge_batch_refresh(global_state_t *global_state) {
+    edge_batch_t *batch = &global_state->edge_batch;
+    adjacency_t *adj = &global_state->graph.adjacency;
+    int num_circles = global_state->graph.num_circles;
+    v2f *positions = global_state->graph.positions;
+
+    if (batch->adjacency_version != adj->version) {
+        if (adj->num_edges > batch->edges_capacity) {
+            batch->edges_capacity = max(adj->num_edges, 2 * batch->edges_capacity);
+            batch->edges = realloc(batch->edges, batch->edges_capacity * sizeof(*batch->edges));
+            assert(batch->edges);
+        }
+        if (num_circles + 1 > batch->slots_capacity) {
+            batch->slots_capacity = max(num_circles + 1, 2 * batch->slots_capacity);
+            batch->first_out_edge = realloc(batch->first_out_edge, batch->slots_capacity * sizeof(int));
+            batch->first_in_edge = realloc(batch->first_in_edge, batch->slots_capacity * sizeof(int));
+            assert(batch->first_out_edge && batch->first_in_edge);
+        }
+        if (adj->num_edges > batch->in_edges_capacity) {
+            batch->in_edges_capacity = max(adj->num_edges, 2 * batch->in_edges_capacity);
+            batch->in_edges = realloc(batch->in_edges, batch->in_edges_capacity * sizeof(int));
+            assert(batch->in_edges);
+        }
+
+        int num_line_vertices = 0;
+        int e = 0;
+        for (int i = 0; i < num_circles; i++) {
+            batch->first_out_edge[i] = e;
+            batch->first_in_edge[i] = 0;
+            for (int j = 0; j < adjacency_degree(adj, i); j++) {
+                edge_geometry_t *geometry = &batch->edges[e++];
+                geometry->orig = i;
+                edge_t *edge = adjacency_edge(adj, i, j);
+                geometry->dest = edge->dest;
+                geometry->index = j;
+                geometry->long_edge = false;
+                geometry->curved = edge->reciprocal;
+                geometry->dirty = true;
+                geometry->first_line_vertex = num_line_vertices;
+                num_line_vertices += geometry->curved ? 2 * EDGE_CURVE_SEGMENTS : 2;
+            }
+        }
+        assert(e == adj->num_edges);
+        batch->first_out_edge[num_circles] = e;
+
+        // NOTE: counting sort of the edges by destination, first_in_edge[v] is used as the cursor of v while
+        // scattering and ends up at the start of v + 1, so everything is shifted back by one afterwards
+        batch->first_in_edge[num_circles] = 0;
+        for (int k = 0; k < e; k++) {
+            batch->first_in_edge[batch->edges[k].dest]++;
+        }
+        int in_start = 0;
+        for (int i = 0; i <= num_circles; i++) {
+            int count = batch->first_in_edge[i];
+            batch->first_in_edge[i] = in_start;
+            in_start += count;
+        }
+        for (int k = 0; k < e; k++) {
+            batch->in_edges[batch->first_in_edge[batch->edges[k].dest]++] = k;
+        }
+        for (int i = num_circles; i > 0; i--) {
+            batch->first_in_edge[i] = batch->first_in_edge[i - 1];
+        }
+        batch->first_in_edge[0] = 0;
+
+        batch->num_edges = e;
+        batch->num_line_vertices = num_line_vertices;
+        batch->num_vertices = num_line_vertices + 3 * e;
+        if (batch->num_vertices > batch->vertices_capacity) {
+            batch->vertices_capacity = max(batch->num_vertices, 2 * batch->vertices_capacity);
+            batch->vertices = realloc(batch->vertices, batch->vertices_capacity * sizeof(*batch->vertices));
+            assert(batch->vertices);
+        }
+        batch->adjacency_version = adj->version;
+        batch->full_upload = true;
+        batch->long_edges_dirty = true;
+        grid_clear(&batch->label_grid);
+
+        for (int k = 0; k < e; k++) {
+            edge_batch_update_edge(batch, positions, k);
+        }
+        batch->num_moved_vertices = 0;
+        return;
+    }
+
+    // NOTE: an edge between two moved vertices (or a vertex moved twice) is only rebuilt once, the second
+    // time its endpoints match the ones it was built for
+    for (int k = 0; k < batch->num_moved_vertices; k++) {
+        int v = batch->moved_vertices[k];
+        for (int e = batch->first_out_edge[v]; e < batch->first_out_edge[v + 1]; e++) {
+            edge_batch_update_edge(batch, positions, e);
+        }
+        for (int i = batch->first_in_edge[v]; i < batch->first_in_edge[v + 1]; i++) {
+            edge_batch_update_edge(batch, positions, batch->in_edges[i]);
+        }
+    }
+    batch->num_moved_vertices = 0;
+}
 
-    if (edge) {
-        v2f edge_weight_pos;
+// finds the edges that can be seen inside [view_min, view_max] (world space) and leaves them in visible_edges,
+// in increasing order, returns false if too many of them can be seen to be worth it (everything should be
+// drawn then)
+// NOTE: the short edges are found through their middle points in label_grid, the long ones are tested one
+// by one
+bool edge_batch_cull(edge_batch_t *batch, v2f view_min, v2f view_max) {
+    int max_visible = batch->num_edges / 16;
+    if (batch->long_edges_dirty) {
+        batch->num_long_edges = 0;
+        for (int e = 0; e < batch->num_edges; e++) {
+            if (!batch->edges[e].long_edge) {
+                continue;
+            }
+            if (batch->num_long_edges == batch->long_edges_capacity) {
+                batch->long_edges_capacity = batch->long_edges_capacity ? 2 * batch->long_edges_capacity : 64;
+                batch->long_edges = realloc(batch->long_edges, batch->long_edges_capacity * sizeof(int));
+                assert(batch->long_edges);
+            }
+            batch->long_edges[batch->num_long_edges++] = e;
+        }
+        batch->long_edges_dirty = false;
+    }
+    if (batch->num_long_edges > max_visible) {
+        return false;
+    }
 
-        v1.x = (v1.x * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_WIDTH / 2);
-        v1.y = (-v1.y * ASPECT_RATIO * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_HEIGHT / 2);
-        v2.x = (v2.x * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_WIDTH / 2);
-        v2.y = (-v2.y * ASPECT_RATIO * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_HEIGHT / 2);
-        v2f temp_v = scale_v2f(sub_v2f(v2, v1), 0.5f);
-        v2f v3 = scale_v2f(normalize_v2f(create_v2f(-temp_v.y, temp_v.x)), FONT_SIZE*1.1f);
+    v2f reach = create_v2f(EDGE_CULL_REACH, EDGE_CULL_REACH);
+    int num_found = grid_query_rect(&batch->label_grid, sub_v2f(view_min, reach), add_v2f(view_max, reach),
+                                    max_visible);
+    if (num_found == -1) {
+        return false;
+    }
 
-        if (curved) {
-            edge_weight_pos.x = (middle_point_on_curve.x * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_WIDTH / 2);
-            edge_weight_pos.y = (-middle_point_on_curve.y * ASPECT_RATIO * global_state->zoom + 1.0f) * (DEFAULT_SCREEN_HEIGHT / 2);
-            edge_weight_pos = add_v2f(edge_weight_pos, scale_v2f(v3, -1));
+    if (num_found + batch->num_long_edges > batch->visible_edges_capacity) {
+        batch->visible_edges_capacity = max(num_found + batch->num_long_edges, 2 * batch->visible_edges_capacity);
+        batch->visible_edges = realloc(batch->visible_edges, batch->visible_edges_capacity * sizeof(int));
+        assert(batch->visible_edges);
+    }
+    // NOTE: merges both lists, the long edges found through the grid are skipped (they are in long_edges)
+    int *found = batch->label_grid.results;
+    int i = 0;
+    int j = 0;
+    batch->num_visible_edges = 0;
+    while (i < num_found || j < batch->num_long_edges) {
+        int e;
+        if (j == batch->num_long_edges || (i < num_found && found[i] < batch->long_edges[j])) {
+            e = found[i++];
+            if (batch->edges[e].long_edge) {
+                continue;
+            }
         } else {
-            v2f v4 = add_v2f(v1, temp_v);
-            edge_weight_pos = add_v2f(v3, v4);
+            e = batch->long_edges[j++];
         }
+        edge_geometry_t *geometry = &batch->edges[e];
+        if (geometry->low.x <= view_max.x && geometry->high.x >= view_min.x &&
+            geometry->low.y <= view_max.y && geometry->high.y >= view_min.y) {
+            batch->visible_edges[batch->num_visible_edges++] = e;
+        }
+    }
+    return true;
+}
 
-        edge->weight_pos_screen = edge_weight_pos;
+// draws the edges found by edge_batch_cull (the edge shader must be in use)
+void edge_batch_draw_visible(edge_batch_t *batch, stream_buffer_t *stream) {
+    int num_indices = 0;
+    for (int k = 0; k < batch->num_visible_edges; k++) {
+        edge_geometry_t *geometry = &batch->edges[batch->visible_edges[k]];
+        num_indices += (geometry->curved ? 2 * EDGE_CURVE_SEGMENTS : 2) + 3;
+    }
+    if (!num_indices) {
+        return;
+    }
+    if (num_indices > batch->visible_indices_capacity) {
+        batch->visible_indices_capacity = max(num_indices, 2 * batch->visible_indices_capacity);
+        batch->visible_indices = realloc(batch->visible_indices, batch->visible_indices_capacity * sizeof(GLuint));
+        assert(batch->visible_indices);
+    }
 
-        char w[10];
-        sprintf(w, "%d", edge->weight);
+    int num_line_indices = 0;
+    for (int k = 0; k < batch->num_visible_edges; k++) {
+        edge_geometry_t *geometry = &batch->edges[batch->visible_edges[k]];
+        int count = geometry->curved ? 2 * EDGE_CURVE_SEGMENTS : 2;
+        for (int v = 0; v < count; v++) {
+            batch->visible_indices[num_line_indices++] = geometry->first_line_vertex + v;
+        }
+    }
+    int num_head_indices = 0;
+    for (int k = 0; k < batch->num_visible_edges; k++) {
+        int first_head_vertex = batch->num_line_vertices + 3 * batch->visible_edges[k];
+        for (int v = 0; v < 3; v++) {
+            batch->visible_indices[num_line_indices + num_head_indices++] = first_head_vertex + v;
+        }
+    }
 
-        font_render_text_horrible(program_font, global_state->font_vbo, global_state->font_vao, cdata,
-                                  ftex, edge_weight_pos.x, edge_weight_pos.y, w,
-                                  weight_color_r, weight_color_g, weight_color_b, true);
+    GLintptr offset = stream_upload(stream, batch->visible_indices, num_indices * sizeof(GLuint), sizeof(GLuint));
+    glBindVertexArray(batch->vao);
+    glDrawElements(GL_LINES, num_line_indices, GL_UNSIGNED_INT, (void *) offset);
+    glDrawElements(GL_TRIANGLES, num_head_indices, GL_UNSIGNED_INT, (void *) (offset + num_line_indices * sizeof(GLuint)));
+    glBindVertexArray(0);
+}
+
+// orders the entrances of a vertex by start time, then by angle (see circle_fragshader.glsl)
+int flood_compare_entrances(const void *a, const void *b) {
+    const GLfloat *x = a, *y = b;
+    if (x[2] != y[2]) {
+        return x[2] < y[2] ? -1 : 1;
     }
+    return (x[3] > y[3]) - (x[3] < y[3]);
+}
+
+// brings the flood buffers up to date with the graph and uploads them, does nothing unless the flood changed
+void flood_batch_refresh(global_state_t *global_state) {
+    flood_batch_t *batch = &global_state->flood_batch;
+    graph_t *graph = &global_state->graph;
+
+    if (batch->flood_version != graph->flood_version) {
+        batch->flood_version = graph->flood_version;
+        batch->time = 0;
+        batch->paused = false;
+        batch->dirty = true;
+        batch->adjacency_version = -1;
+    }
+    if (batch->num_circles != graph->num_circles) {
+        batch->dirty = true;
+    }
+    if (graph->current_animation_root == -1) {
+        return;
+    }
+
+    // NOTE: the edges don't depend on the positions, they are only rebuilt when the flood or the edges change
+    adjacency_t *adj = &graph->adjacency;
+    if (batch->adjacency_version != adj->version) {
+        batch->adjacency_version = adj->version;
+        if (2 * adj->num_edges > batch->edges_capacity) {
+            batch->edges_capacity = max(2 * adj->num_edges, 2 * batch->edges_capacity);
+            batch->edges = realloc(batch->edges, batch->edges_capacity * sizeof(GLfloat));
+            assert(batch->edges);
+        }
+        // NOTE: same order as edge_batch_refresh
+        GLfloat *edge = batch->edges;
+        for (int i = 0; i < graph->num_circles; i++) {
+            float start = adjacency_degree(adj, i) ? graph_fill_end(graph, i) : INFINITY;
+            for (int j = 0; j < adjacency_degree(adj, i); j++, edge += 2) {
+                edge[0] = start != INFINITY ? start : -1;
+                edge[1] = start != INFINITY ? start + FLOOD_EDGE_SECONDS : -1;
+            }
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, batch->edges_buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 2 * adj->num_edges * sizeof(GLfloat), batch->edges, GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    if (!batch->dirty) {
+        return;
+    }
+    batch->dirty = false;
+    batch->num_circles = graph->num_circles;
+
+    if (4 * graph->num_circles > batch->vertices_capacity) {
+        batch->vertices_capacity = max(4 * graph->num_circles, 2 * batch->vertices_capacity);
+        batch->vertices = realloc(batch->vertices, batch->vertices_capacity * sizeof(GLint));
+        assert(batch->vertices);
+    }
+    if (4 * graph->num_fill_entrances > batch->entrances_capacity) {
+        batch->entrances_capacity = max(4 * graph->num_fill_entrances, 2 * batch->entrances_capacity);
+        batch->entrances = realloc(batch->entrances, batch->entrances_capacity * sizeof(GLfloat));
+        assert(batch->entrances);
+    }
+
+    v2f *positions = graph->positions;
+    for (int i = 0; i < graph->num_circles; i++) {
+        GLint *vertex = &batch->vertices[4 * i];
+        memset(vertex, 0, 4 * sizeof(GLint));
+        if (!adjacency_is_vertex(&graph->adjacency, i) || !graph->filled[i]) {
+            continue;
+        }
+
+        fill_entrance_t *entrances = &graph->fill_entrances[graph->fill_start[i]];
+        GLfloat *first_entrance = &batch->entrances[4 * graph->fill_start[i]];
+        float first_start = entrances[0].start;
+        for (int j = 0; j < graph->fill_count[i]; j++) {
+            GLfloat *entrance = &first_entrance[4 * j];
+            // NOTE: the entrance is on the border of the circle, facing the father (the root is its own
+            // entrance, in the center)
+            v2f direction = sub_v2f(positions[entrances[j].vertex], positions[i]);
+            double length = sqrt(direction.x * direction.x + direction.y * direction.y);
+            direction = length > 0 ? scale_v2f(direction, 1 / length) : create_v2f(0, 0);
+            entrance[0] = direction.x;
+            entrance[1] = direction.y;
+            entrance[2] = entrances[j].start;
+            entrance[3] = atan2(direction.y, direction.x);
+            first_start = min(first_start, entrances[j].start);
+        }
+        qsort(first_entrance, graph->fill_count[i], 4 * sizeof(GLfloat), flood_compare_entrances);
+        int num_first = 0;
+        while (num_first < graph->fill_count[i] && first_entrance[4 * num_first + 2] == first_start) {
+            num_first++;
+        }
+
+        // NOTE: the fill keeps growing 0.1 past the border so the smoothstep of the shader fades out
+        float end = graph_fill_end(graph, i) + 0.1f;
+        vertex[0] = graph->fill_start[i];
+        vertex[1] = graph->fill_count[i];
+        vertex[2] = num_first;
+        memcpy(&vertex[3], &end, sizeof(end));
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, batch->vertices_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 4 * graph->num_circles * sizeof(GLint), batch->vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, batch->entrances_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 4 * graph->num_fill_entrances * sizeof(GLfloat), batch->entrances, GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// sends whatever edge_batch_refresh modified to the GPU
+void edge_batch_upload(edge_batch_t *batch) {
+    glBindBuffer(GL_ARRAY_BUFFER, batch->vbo);
+    if (batch->full_upload) {
+        glBufferData(GL_ARRAY_BUFFER, batch->num_vertices * sizeof(*batch->vertices), batch->vertices, GL_DYNAMIC_DRAW);
+    } else if (batch->upload_start < batch->upload_end) {
+        glBufferSubData(GL_ARRAY_BUFFER, batch->upload_start * sizeof(*batch->vertices),
+                        (batch->upload_end - batch->upload_start) * sizeof(*batch->vertices),
+                        &batch->vertices[batch->upload_start]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    batch->full_upload = false;
+    batch->upload_start = INT32_MAX;
+    batch->upload_end = 0;
+}
+
+// draws the edge being currently created (v1 and v2 in world space)
+void draw_edge_preview(global_state_t *global_state, v2f v1, v2f v2) {
+    GLfloat color[3] = {ARROW_DEFAULT_COLOR};
+    edge_vertex_t vertices[2 + 3];
+    build_edge_geometry(v1, v2, false, -1, color, &vertices[0], &vertices[2]);
+
+    GLint first = stream_upload(&global_state->stream, vertices, sizeof(vertices), sizeof(edge_vertex_t)) /
+                  sizeof(edge_vertex_t);
+    glBindVertexArray(global_state->edge_vao);
+    glDrawArrays(GL_LINES, first, 2);
+    glDrawArrays(GL_TRIANGLES, first + 2, 3);
+    glBindVertexArray(0);
+}
+
+// draws the outline of the selection box with corners `a` and `b` (world space)
+void draw_selection_box(global_state_t *global_state, v2f a, v2f b) {
+    GLfloat color[3] = {ARROW_DEFAULT_COLOR};
+    v2f no_offset = create_v2f(0, 0);
+    v2f corners[4] = {a, create_v2f(b.x, a.y), b, create_v2f(a.x, b.y)};
+    edge_vertex_t vertices[2 * 4];
+    for (int i = 0; i < 4; i++) {
+        set_edge_vertex(&vertices[2 * i], corners[i], no_offset, 0, -1, color);
+        set_edge_vertex(&vertices[2 * i + 1], corners[(i + 1) % 4], no_offset, 0, -1, color);
+    }
+
+    GLint first = stream_upload(&global_state->stream, vertices, sizeof(vertices), sizeof(edge_vertex_t)) /
+                  sizeof(edge_vertex_t);
+    glBindVertexArray(global_state->edge_vao);
+    glDrawArrays(GL_LINES, first, 2 * 4);
+    glBindVertexArray(0);
 }
 
 int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--headless")) {
+            return headless_main(argc, argv);
+        }
+    }
+
     // glfw, gl3w and context initialization
 
     if (!glfwInit()) {
@@ -830,6 +1603,8 @@ int main(int argc, char **argv) {
 
     GLuint shader_program = initialize_shader("vertexshader.glsl", "fragshader.glsl");
     GLuint font_shader_program = initialize_shader("font_vertexshader.glsl", "font_fragshader.glsl");
+    GLuint circle_shader_program = initialize_shader("circle_vertexshader.glsl", "circle_fragshader.glsl");
+    GLuint edge_shader_program = initialize_shader("edge_vertexshader.glsl", "edge_fragshader.glsl");
 
     // initialize global state
 
@@ -837,7 +1612,13 @@ int main(int argc, char **argv) {
     global_state.zoom = 0.1f;
     global_state.delta_time = 0;
     global_state.dragging_map = FALSE;
-    global_state.dragging_vertex = FALSE;
+    global_state.dragging_vertex = -1;
+    global_state.selecting_box = false;
+    global_state.box_selection = NULL;
+    global_state.dragged_vertices = NULL;
+    global_state.num_dragged_vertices = 0;
+    global_state.dragged_vertices_capacity = 0;
+    global_state.box_selection_capacity = 0;
     global_state.modifying_vertex = -1; // no vertex currently selected
     global_state.last_mouse.x = -1;
     global_state.last_mouse.y = -1;
@@ -845,22 +1626,79 @@ int main(int argc, char **argv) {
     global_state.last_translation.y = 0;
     global_state.cur_translation.x = 0;
     global_state.cur_translation.y = 0;
-    global_state.circles = malloc(MAX_VERTICES * sizeof(*global_state.circles));
-    global_state.num_circles = 0;
+    graph_init(&global_state.graph);
     global_state.editing_circle = -1;
-    global_state.editing_edge = NULL;
+    global_state.editing_edge_orig = -1;
+    global_state.editing_edge_dest = -1;
     global_state.showing_menu = true;
+    global_state.export_job = NULL;
+    global_state.circle_instances = NULL;
+    global_state.circle_instances_capacity = 0;
+    global_state.visible_vertices = NULL;
+    global_state.flood_batch.vertices = NULL;
+    global_state.flood_batch.vertices_capacity = 0;
+    global_state.flood_batch.entrances = NULL;
+    global_state.flood_batch.entrances_capacity = 0;
+    global_state.flood_batch.edges = NULL;
+    global_state.flood_batch.edges_capacity = 0;
+    global_state.flood_batch.flood_version = -1;
+    global_state.flood_batch.adjacency_version = -1;
+    global_state.flood_batch.num_circles = 0;
+    global_state.flood_batch.dirty = true;
+    global_state.flood_batch.time = 0;
+    global_state.flood_batch.paused = false;
+    global_state.edge_batch.edges = NULL;
+    global_state.edge_batch.edges_capacity = 0;
+    global_state.edge_batch.num_edges = 0;
+    global_state.edge_batch.vertices = NULL;
+    global_state.edge_batch.vertices_capacity = 0;
+    global_state.edge_batch.num_line_vertices = 0;
+    global_state.edge_batch.num_vertices = 0;
+    global_state.edge_batch.adjacency_version = -1;
+    global_state.edge_batch.full_upload = false;
+    global_state.edge_batch.upload_start = INT32_MAX;
+    global_state.edge_batch.upload_end = 0;
+    global_state.edge_batch.first_out_edge = NULL;
+    global_state.edge_batch.first_in_edge = NULL;
+    global_state.edge_batch.slots_capacity = 0;
+    global_state.edge_batch.in_edges = NULL;
+    global_state.edge_batch.in_edges_capacity = 0;
+    global_state.edge_batch.moved_vertices = NULL;
+    global_state.edge_batch.num_moved_vertices = 0;
+    global_state.edge_batch.moved_vertices_capacity = 0;
+    grid_init(&global_state.edge_batch.label_grid, 2.0f /* radius * 2 */);
+    global_state.edge_batch.long_edges = NULL;
+    global_state.edge_batch.num_long_edges = 0;
+    global_state.edge_batch.long_edges_capacity = 0;
+    global_state.edge_batch.long_edges_dirty = true;
+    global_state.edge_batch.visible_edges = NULL;
+    global_state.edge_batch.num_visible_edges = 0;
+    global_state.edge_batch.visible_edges_capacity = 0;
+    global_state.edge_batch.visible_indices = NULL;
+    global_state.edge_batch.visible_indices_capacity = 0;
+    global_state.font_batch.vertices = NULL;
+    global_state.font_batch.num_vertices = 0;
+    global_state.font_batch.capacity = 0;
+    global_state.font_batch.program = font_shader_program;
     //global_state.temp_weight_str; // NOTE: no need to initialize this
-    // DEBUG: add some circles just for testing purposes
-    create_vertex(&global_state, create_v2f(1.2, -2.6), 1);
-    create_vertex(&global_state, create_v2f(-6.4, -1.1), 1);
-    create_vertex(&global_state, create_v2f(-4.1, -4.0), 1);
+
+    command_line_t command_line;
+    if (!parse_arguments(&global_state, &command_line, argc, argv)) {
+        // DEBUG: add some circles just for testing purposes
+        graph_create_vertex(&global_state.graph, create_v2f(1.2, -2.6), 1);
+        graph_create_vertex(&global_state.graph, create_v2f(-6.4, -1.1), 1);
+        graph_create_vertex(&global_state.graph, create_v2f(-4.1, -4.0), 1);
+    }
+    run_commands(&global_state, &command_line);
 
     glfwSetWindowUserPointer(window, (void *) &global_state);
 
 
     // buffers initialization
 
+    // stream buffer (shared by every vao that draws per-frame data)
+    stream_init(&global_state.stream, STREAM_BUFFER_SIZE);
+
     // vertices buffers
     {
         GLuint VBO;
@@ -882,32 +1720,93 @@ int main(int argc, char **argv) {
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void *) 0);
         glEnableVertexAttribArray(0);
         glBindVertexArray(0);
-    }
 
-    // edge buffers
-    {
-        glGenBuffers(1, &global_state.edge_vbo);
-        glGenVertexArrays(1, &global_state.edge_vao);
+        // instanced circles share the same geometry, the per-instance attributes come from the stream buffer
+        glGenVertexArrays(1, &global_state.circle_instance_vao);
 
-        glBindVertexArray(global_state.edge_vao);
-        glBindBuffer(GL_ARRAY_BUFFER, global_state.edge_vbo);
+        glBindVertexArray(global_state.circle_instance_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void *) 0);
         glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, global_state.stream.buffer);
+        // NOTE: the offsets are set again before every draw (see the circle drawing)
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(circle_instance_t), (void *) 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(circle_instance_t), (void *) (2 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(2);
+        glVertexAttribDivisor(2, 1);
+        glVertexAttribIPointer(3, 1, GL_INT, sizeof(circle_instance_t), (void *) (5 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(3, 1);
+        glBindVertexArray(0);
+    }
+
+    // flood buffers (read by the circle and edge shaders as buffer textures)
+    {
+        flood_batch_t *batch = &global_state.flood_batch;
+        glGenBuffers(1, &batch->vertices_buffer);
+        glGenBuffers(1, &batch->entrances_buffer);
+        glGenBuffers(1, &batch->edges_buffer);
+        glGenTextures(1, &batch->vertices_texture);
+        glGenTextures(1, &batch->entrances_texture);
+        glGenTextures(1, &batch->edges_texture);
+        // NOTE: a buffer only exists after it is bound for the first time, glTexBuffer fails before that
+        glBindBuffer(GL_TEXTURE_BUFFER, batch->vertices_buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, batch->entrances_buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, batch->edges_buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, batch->vertices_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, batch->vertices_buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, batch->entrances_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, batch->entrances_buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, batch->edges_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, batch->edges_buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // edge buffers
+    {
+        GLuint vaos[2];
+        GLuint vbos[2] = {global_state.stream.buffer};
+        glGenBuffers(1, &vbos[1]);
+        glGenVertexArrays(2, vaos);
+        global_state.edge_vao = vaos[0];
+        global_state.edge_batch.vao = vaos[1];
+        global_state.edge_batch.vbo = vbos[1];
+
+        for (int i = 0; i < 2; i++) {
+            glBindVertexArray(vaos[i]);
+            glBindBuffer(GL_ARRAY_BUFFER, vbos[i]);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(edge_vertex_t), (void *) 0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(edge_vertex_t), (void *) (2 * sizeof(GLfloat)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(edge_vertex_t), (void *) (4 * sizeof(GLfloat)));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(edge_vertex_t), (void *) (7 * sizeof(GLfloat)));
+            glEnableVertexAttribArray(3);
+            glVertexAttribIPointer(4, 1, GL_INT, sizeof(edge_vertex_t), (void *) (8 * sizeof(GLfloat)));
+            glEnableVertexAttribArray(4);
+        }
+        // NOTE: the element buffer binding is part of the vao state
+        glBindVertexArray(global_state.edge_batch.vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, global_state.stream.buffer);
         glBindVertexArray(0);
     }
 
     // font buffers
     {
-        glGenBuffers(1, &global_state.font_vbo);
-        glGenVertexArrays(1, &global_state.font_vao);
+        glGenVertexArrays(1, &global_state.font_batch.vao);
 
-        glBindVertexArray(global_state.font_vao);
-        glBindBuffer(GL_ARRAY_BUFFER, global_state.font_vbo);
-        // NOTE: currently we are uploading data to the font_vbo every frame
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void *) 0);
+        glBindVertexArray(global_state.font_batch.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, global_state.stream.buffer);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(font_vertex_t), (void *) 0);
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void *) (3 * sizeof(GLfloat)));
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(font_vertex_t), (void *) (3 * sizeof(GLfloat)));
         glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(font_vertex_t), (void *) (5 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(2);
         glBindVertexArray(0);
     }
 
@@ -920,9 +1819,9 @@ int main(int argc, char **argv) {
         float background[6 * 3] = {
             DEFAULT_SCREEN_WIDTH - 500, - 70, 0.5,
             DEFAULT_SCREEN_WIDTH - 5, - 70, 0.5,
-            DEFAULT_SCREEN_WIDTH - 500, - 370, 0.5,
-            DEFAULT_SCREEN_WIDTH - 500, - 370, 0.5,
-            DEFAULT_SCREEN_WIDTH - 5, - 370, 0.5,
+            DEFAULT_SCREEN_WIDTH - 500, - 454, 0.5,
+            DEFAULT_SCREEN_WIDTH - 500, - 454, 0.5,
+            DEFAULT_SCREEN_WIDTH - 5, - 454, 0.5,
             DEFAULT_SCREEN_WIDTH - 5, - 70, 0.5,
         };
 
@@ -940,24 +1839,51 @@ int main(int argc, char **argv) {
     GLint aspect_ratio_uniform = glGetUniformLocation(shader_program, "aspect_ratio");
     GLint translation_uniform = glGetUniformLocation(shader_program, "translation");
     GLint color_uniform = glGetUniformLocation(shader_program, "color");
-    GLint filled_uniform = glGetUniformLocation(shader_program, "filled");
-    GLint fill_entrance_uniform = glGetUniformLocation(shader_program, "fill_entrance");
-    GLint fill_radius_uniform = glGetUniformLocation(shader_program, "fill_radius");
-    GLint num_entrances_uniform = glGetUniformLocation(shader_program, "num_entrances");
     GLint font_tex_uniform = glGetUniformLocation(font_shader_program, "tex");
-
+    GLint font_window_width_uniform = glGetUniformLocation(font_shader_program, "window_width");
+    GLint font_window_height_uniform = glGetUniformLocation(font_shader_program, "window_height");
+    GLint circle_scale_uniform = glGetUniformLocation(circle_shader_program, "scale");
+    GLint circle_aspect_ratio_uniform = glGetUniformLocation(circle_shader_program, "aspect_ratio");
+    GLint circle_translation_uniform = glGetUniformLocation(circle_shader_program, "translation");
+    GLint circle_flooding_uniform = glGetUniformLocation(circle_shader_program, "flooding");
+    GLint circle_time_uniform = glGetUniformLocation(circle_shader_program, "time");
+    GLint circle_filled_color_uniform = glGetUniformLocation(circle_shader_program, "filled_color");
+    GLint circle_flood_vertices_uniform = glGetUniformLocation(circle_shader_program, "flood_vertices");
+    GLint circle_flood_entrances_uniform = glGetUniformLocation(circle_shader_program, "flood_entrances");
+    GLint edge_scale_uniform = glGetUniformLocation(edge_shader_program, "scale");
+    GLint edge_aspect_ratio_uniform = glGetUniformLocation(edge_shader_program, "aspect_ratio");
+    GLint edge_translation_uniform = glGetUniformLocation(edge_shader_program, "translation");
+    GLint edge_flooding_uniform = glGetUniformLocation(edge_shader_program, "flooding");
+    GLint edge_time_uniform = glGetUniformLocation(edge_shader_program, "time");
+    GLint edge_filled_color_uniform = glGetUniformLocation(edge_shader_program, "filled_color");
+    GLint edge_flood_edges_uniform = glGetUniformLocation(edge_shader_program, "flood_edges");
+
+
+    // initialize circle data
+    // NOTE: texture unit 0 is used by the font
+    glUseProgram(circle_shader_program);
+    glUniform1i(circle_flood_vertices_uniform, 1);
+    glUniform1i(circle_flood_entrances_uniform, 2);
+    glUniform3f(circle_filled_color_uniform, VERTEX_FILLED_COLOR);
+
+    // initialize edge data
+    glUseProgram(edge_shader_program);
+    glUniform1i(edge_flood_edges_uniform, 3);
+    glUniform3f(edge_filled_color_uniform, ARROW_FILLED_COLOR);
 
     // initialize font data
-    stbtt_bakedchar cdata[96]; // ASCII alphanumeric range
-    GLuint ftex;
-    glGenTextures(1, &ftex);
+    glUseProgram(font_shader_program);
+    glUniform1i(font_tex_uniform, 0);
+    glUniform1f(font_window_width_uniform, DEFAULT_SCREEN_WIDTH);
+    glUniform1f(font_window_height_uniform, DEFAULT_SCREEN_HEIGHT);
+    glGenTextures(1, &global_state.font_batch.ftex);
     {
         unsigned char *ttf_buffer = malloc((1<<20) * sizeof(*ttf_buffer));
         unsigned char temp_bitmap[512*521];
         FILE *f = fopen("arial.ttf", "rb");
         fread(ttf_buffer, 1, 1<<20, f);
-        stbtt_BakeFontBitmap(ttf_buffer, 0, FONT_SIZE, temp_bitmap, 512, 512, 32, 96, cdata);
-        glBindTexture(GL_TEXTURE_2D, ftex);
+        stbtt_BakeFontBitmap(ttf_buffer, 0, FONT_SIZE, temp_bitmap, 512, 512, 32, 96, global_state.font_batch.cdata);
+        glBindTexture(GL_TEXTURE_2D, global_state.font_batch.ftex);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, 512, 512, 0, GL_RED, GL_UNSIGNED_BYTE, temp_bitmap);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glGenerateMipmap(GL_TEXTURE_2D);
@@ -984,14 +1910,18 @@ int main(int argc, char **argv) {
             global_state.cur_translation = scale_v2f(sub_v2f(now, last), -1);
         }
         // TODO; make sure this works if currently also dragging map (does it need to?)
-        // TODO: make it possible to select and drag multiple vertices simultaneously
-        if (global_state.dragging_vertex) {
+        if (global_state.dragging_vertex != -1) {
             v2f temp = get_cursor_world_space(window, global_state.last_translation, global_state.zoom);
-            for (int i = 0; i < global_state.num_circles; i++) {
-                if (global_state.circles[i].selected) {
-                    global_state.circles[i].pos.x = temp.x;
-                    global_state.circles[i].pos.y = temp.y;
-                }
+            v2f *positions = global_state.graph.positions;
+            // NOTE: the other selected vertices keep their offset to the dragged one
+            v2f delta = sub_v2f(temp, positions[global_state.dragging_vertex]);
+            for (int k = 0; k < global_state.num_dragged_vertices; k++) {
+                int i = global_state.dragged_vertices[k];
+                v2f p = i == global_state.dragging_vertex ? temp : add_v2f(positions[i], delta);
+                grid_move(&global_state.graph.vertex_grid, i, positions[i], p);
+                positions[i] = p;
+                edge_batch_vertex_moved(&global_state.edge_batch, i);
+                global_state.flood_batch.dirty = true;
             }
         }
 
@@ -1007,130 +1937,176 @@ int main(int argc, char **argv) {
         frame_translation.x = global_state.last_translation.x + global_state.cur_translation.x;
         frame_translation.y = global_state.last_translation.y + global_state.cur_translation.y;
 
+        // world space rectangle seen through the window, whatever is outside of it gets culled
+        v2f view_half_size = create_v2f(1 / global_state.zoom, 1 / (global_state.zoom * ASPECT_RATIO));
+        v2f view_min = sub_v2f(scale_v2f(frame_translation, -1), view_half_size);
+        v2f view_max = add_v2f(scale_v2f(frame_translation, -1), view_half_size);
+
         // draw vertices
         {
-            vertex_t *circles = global_state.circles;
-            float fill_radius_step = 1.0f * global_state.delta_time;
-
-            for (int i = 0; i < global_state.num_circles; i++) {
-                glUseProgram(shader_program);
-                v2f v = add_v2f(frame_translation, circles[i].pos);
-                glUniform3f(translation_uniform, v.x, v.y, 0.0f);
-                glUniform1i(filled_uniform, circles[i].filled);
-                glUniform1i(num_entrances_uniform, circles[i].num_fill_entrances);
-                if (circles[i].filled > 0) {
-                    if (global_state.current_animation_root == i) {
-                        circles[i].fill_radius[0] = min(circles[i].fill_radius[0] + fill_radius_step, 1.1f /* radius */);
-                        if (circles[i].fill_radius[0] > 1.0f /* radius */) {
-                            circles[i].filled = 2;
-                        }
-                        GLfloat t[2] = {v.x, v.y};
-                        glUniform2fv(fill_entrance_uniform, 1, t);
-                        glUniform1fv(fill_radius_uniform, 1, circles[i].fill_radius);
-                    } else {
-                        GLfloat fill_entrances[MAX_VERTEX_ENTRANCES * 2] = {0};
-                        int aux_count = 0;
-                        for (int j = 0; j < circles[i].num_fill_entrances; j++) {
-                            vertex_t predecessor = circles[circles[i].fill_entrance_index[j]];
-                            if (predecessor.filled == 2) {
-                                circles[i].fill_radius[j] = min(circles[i].fill_radius[j] + fill_radius_step, 2.1f /* radius */);
-                                if (circles[i].fill_radius[j] > 2.0f /* radius * 2 */) {
-                                    circles[i].filled = 2;
-                                }
-                            }
-                            v2f fill_entrance = sub_v2f(circles[i].pos, predecessor.pos);
-                            fill_entrance = add_v2f(fill_entrance, scale_v2f(normalize_v2f(fill_entrance), -1.0f /*radius*/));
-                            fill_entrance = add_v2f(fill_entrance, predecessor.pos);
-                            fill_entrance = add_v2f(frame_translation, fill_entrance);
-                            fill_entrances[aux_count++] = fill_entrance.x;
-                            fill_entrances[aux_count++] = fill_entrance.y;
-                        }
-                        glUniform2fv(fill_entrance_uniform, circles[i].num_fill_entrances, fill_entrances);
-                        glUniform1fv(fill_radius_uniform, circles[i].num_fill_entrances, circles[i].fill_radius);
-                    }
-                }
-                if (circles[i].filled) {
-                    glUniform3f(color_uniform, VERTEX_FILLED_COLOR);
-                } else if (circles[i].selected) { // TODO: maybe remove/rethink this whole selected concept
-                    glUniform3f(color_uniform, VERTEX_SELECTED_COLOR);
+            v2f *positions = global_state.graph.positions;
+            int *weights = global_state.graph.weights;
+            bool *selected = global_state.graph.selected;
+            v2f radius = create_v2f(1.0f, 1.0f);
+
+            if (global_state.graph.num_circles > global_state.circle_instances_capacity) {
+                global_state.circle_instances_capacity = max(global_state.graph.num_circles, 2 * global_state.circle_instances_capacity);
+                global_state.circle_instances = realloc(global_state.circle_instances,
+                                                        global_state.circle_instances_capacity * sizeof(circle_instance_t));
+                global_state.visible_vertices = realloc(global_state.visible_vertices,
+                                                        global_state.circle_instances_capacity * sizeof(int));
+                assert(global_state.circle_instances && global_state.visible_vertices);
+            }
+
+            // NOTE: the flood animation is played by the circle shaders, all it needs from here is the time
+            flood_batch_t *flood = &global_state.flood_batch;
+            flood_batch_refresh(&global_state);
+            bool flooding = global_state.graph.current_animation_root != -1;
+            if (flooding && !flood->paused) {
+                flood->time += global_state.delta_time;
+            }
+
+            int *visible_vertices = global_state.visible_vertices;
+            int num_visible_vertices = graph_vertices_in_rect(&global_state.graph, sub_v2f(view_min, radius),
+                                                              add_v2f(view_max, radius), visible_vertices);
+            for (int k = 0; k < num_visible_vertices; k++) {
+                int i = visible_vertices[k];
+                circle_instance_t *instance = &global_state.circle_instances[k];
+                instance->x = positions[i].x;
+                instance->y = positions[i].y;
+                instance->vertex = i;
+                if (selected[i]) { // TODO: maybe remove/rethink this whole selected concept
+                    GLfloat color[3] = {VERTEX_SELECTED_COLOR};
+                    memcpy(&instance->r, color, sizeof(color));
                 } else {
-                    glUniform3f(color_uniform, VERTEX_DEFAULT_COLOR);
+                    GLfloat color[3] = {VERTEX_DEFAULT_COLOR};
+                    memcpy(&instance->r, color, sizeof(color));
                 }
-                glBindVertexArray(global_state.default_vao);
-                glDrawArrays(GL_TRIANGLE_FAN, 0, NUM_SECTIONS_CIRCLE);
-                glBindVertexArray(0);
+            }
 
-                // draw vertex weight
-                {
-                    v.x = (v.x * global_state.zoom + 1.0f) * (DEFAULT_SCREEN_WIDTH / 2);
-                    v.y = (-v.y * ASPECT_RATIO * global_state.zoom + 1.0f) * (DEFAULT_SCREEN_HEIGHT / 2);
-                    char str[10];
-                    sprintf(str, "%d", circles[i].weight);
+            if (num_visible_vertices) {
+                glUseProgram(circle_shader_program);
+                glUniform1f(circle_scale_uniform, global_state.zoom);
+                glUniform1f(circle_aspect_ratio_uniform, ASPECT_RATIO);
+                glUniform2f(circle_translation_uniform, frame_translation.x, frame_translation.y);
+                glUniform1i(circle_flooding_uniform, flooding);
+                glUniform1f(circle_time_uniform, flood->time);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_BUFFER, flood->vertices_texture);
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_BUFFER, flood->entrances_texture);
+                glActiveTexture(GL_TEXTURE0);
+
+                // NOTE: glDrawArraysInstanced has no first instance (before 4.2), the per-instance attributes
+                // are pointed at this frame's instances instead
+                GLintptr offset = stream_upload(&global_state.stream, global_state.circle_instances,
+                                                num_visible_vertices * sizeof(circle_instance_t), sizeof(GLfloat));
+                glBindVertexArray(global_state.circle_instance_vao);
+                glBindBuffer(GL_ARRAY_BUFFER, global_state.stream.buffer);
+                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(circle_instance_t), (void *) offset);
+                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(circle_instance_t),
+                                      (void *) (offset + 2 * sizeof(GLfloat)));
+                glVertexAttribIPointer(3, 1, GL_INT, sizeof(circle_instance_t), (void *) (offset + 5 * sizeof(GLfloat)));
+                glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, NUM_SECTIONS_CIRCLE, num_visible_vertices);
+                glBindVertexArray(0);
+            }
 
-                    if (global_state.editing_circle == i) {
-                        font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                                  ftex, v.x, v.y, str, WEIGHT_EDITING_COLOR, true);
-                    } else {
-                        font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                                  ftex, v.x, v.y, str, 0, 0, 0, true);
-                    }
+            // draw vertex weights
+            // NOTE: this must come after the circles, otherwise the text quads would hide them in the depth buffer
+            for (int k = 0; k < num_visible_vertices; k++) {
+                int i = visible_vertices[k];
+                v2f v = add_v2f(frame_translation, positions[i]);
+                v.x = (v.x * global_state.zoom + 1.0f) * (DEFAULT_SCREEN_WIDTH / 2);
+                v.y = (-v.y * ASPECT_RATIO * global_state.zoom + 1.0f) * (DEFAULT_SCREEN_HEIGHT / 2);
+                char str[10];
+                sprintf(str, "%d", weights[i]);
+
+                if (global_state.editing_circle == i) {
+                    font_push_text(&global_state.font_batch, v.x, v.y, str, WEIGHT_EDITING_COLOR, true);
+                } else {
+                    font_push_text(&global_state.font_batch, v.x, v.y, str, 0, 0, 0, true);
                 }
             }
         }
 
         // draw edges
         {
-            // TODO: clean up all of this, this should all probably be inside the draw_edge call
-
-            // vertices children
-            for (int i = 0; i < global_state.num_circles; i++) {
-                for (int j = 0; j < global_state.circles[i].num_children; j++) {
-                    edge_t *edge = &global_state.circles[i].children[j];
-                    int dest = edge->dest;
-
-                    glUseProgram(shader_program);
-                    glUniform3f(translation_uniform, 0, 0, 0);
-                    glUniform1i(filled_uniform, 0);
-                    glUniform2f(fill_entrance_uniform, 0, 0);
-                    glUniform1f(fill_radius_uniform, 0);
-
-                    if (global_state.circles[i].filled) {
-                        glUniform3f(color_uniform, ARROW_FILLED_COLOR);
-                    } else {
-                        glUniform3f(color_uniform, ARROW_DEFAULT_COLOR);
-                    }
-
-                    v2f v1 = add_v2f(frame_translation, global_state.circles[i].pos);
-                    v2f v2 = add_v2f(frame_translation, global_state.circles[dest].pos);
-
-                    // TODO: optimize this by ordering children by index and using binary search when needed (all over the program)
-                    bool straight = true;
-                    for (int k = 0; k < global_state.circles[dest].num_children; k++) {
-                        if (global_state.circles[dest].children[k].dest == i) {
-                            straight = false;
-                            break;
-                        }
-                    }
+            edge_batch_t *batch = &global_state.edge_batch;
+            edge_batch_refresh(&global_state);
+            edge_batch_upload(batch);
+
+            glUseProgram(edge_shader_program);
+            glUniform1f(edge_scale_uniform, global_state.zoom);
+            glUniform1f(edge_aspect_ratio_uniform, ASPECT_RATIO);
+            glUniform2f(edge_translation_uniform, frame_translation.x, frame_translation.y);
+            glUniform1i(edge_flooding_uniform, global_state.graph.current_animation_root != -1);
+            glUniform1f(edge_time_uniform, global_state.flood_batch.time);
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_BUFFER, global_state.flood_batch.edges_texture);
+            glActiveTexture(GL_TEXTURE0);
 
-                    draw_edge(edge, global_state.edge_vbo, global_state.edge_vao, global_state.font_vbo, global_state.font_vao,
-                              &global_state, v1, v2, !straight, 0, 0, 0, shader_program, font_shader_program, cdata, ftex);
-                }
+            // NOTE: the arrow heads are offset in screen units, the margin keeps the ones of edges that end right
+            // outside the view
+            v2f margin = create_v2f(2 * ARROW_HEAD_CONSTANT / global_state.zoom, 2 * ARROW_HEAD_CONSTANT / global_state.zoom);
+            if (edge_batch_cull(batch, sub_v2f(view_min, margin), add_v2f(view_max, margin))) {
+                edge_batch_draw_visible(batch, &global_state.stream);
+            } else {
+                glBindVertexArray(batch->vao);
+                glDrawArrays(GL_LINES, 0, batch->num_line_vertices);
+                glDrawArrays(GL_TRIANGLES, batch->num_line_vertices, batch->num_vertices - batch->num_line_vertices);
+                glBindVertexArray(0);
             }
 
-            glUseProgram(shader_program);
-            glUniform3f(translation_uniform, 0, 0, 0);
-            // TODO: think about this
-            glUniform1i(filled_uniform, 0);
-            glUniform2f(fill_entrance_uniform, 0, 0);
-            glUniform1f(fill_radius_uniform, 0);
-            glUniform3f(color_uniform, ARROW_DEFAULT_COLOR);
             // edge being currently created
             if (global_state.modifying_vertex != -1) {
-                v2f v1 = add_v2f(frame_translation, global_state.circles[global_state.modifying_vertex].pos);
-                v2f v2 = get_cursor_untranslated_world_space(window, global_state.zoom);
-                draw_edge(NULL, global_state.edge_vbo, global_state.edge_vao, global_state.font_vbo, global_state.font_vao,
-                          &global_state, v1, v2, false, 0, 0, 0, shader_program, font_shader_program, cdata, ftex);
+                v2f v1 = global_state.graph.positions[global_state.modifying_vertex];
+                v2f v2 = sub_v2f(get_cursor_untranslated_world_space(window, global_state.zoom), frame_translation);
+                draw_edge_preview(&global_state, v1, v2);
+            }
+
+            // selection box
+            if (global_state.selecting_box) {
+                v2f v = sub_v2f(get_cursor_untranslated_world_space(window, global_state.zoom), frame_translation);
+                draw_selection_box(&global_state, global_state.box_start, v);
+            }
+
+            // edge weights
+            // NOTE: a weight is drawn FONT_SIZE * 1.1 pixels away from the middle point of its edge, the margin
+            // also leaves room for the longest weights
+            adjacency_t *adj = &global_state.graph.adjacency;
+            double pixels_per_unit = global_state.zoom * (DEFAULT_SCREEN_WIDTH / 2);
+            double label_margin = (FONT_SIZE * 1.1f + 5 * FONT_SIZE) / pixels_per_unit;
+            v2f labels_min = sub_v2f(view_min, create_v2f(label_margin, label_margin));
+            v2f labels_max = add_v2f(view_max, create_v2f(label_margin, label_margin));
+            int num_labels = grid_query_rect(&batch->label_grid, labels_min, labels_max, batch->num_edges / 16);
+            int *labels = batch->label_grid.results;
+            bool all_labels = num_labels == -1;
+            if (all_labels) {
+                num_labels = batch->num_edges;
+            }
+            for (int k = 0; k < num_labels; k++) {
+                int e = all_labels ? k : labels[k];
+                edge_geometry_t *geometry = &batch->edges[e];
+                if (all_labels &&
+                    (geometry->middle_point.x < labels_min.x || geometry->middle_point.x > labels_max.x ||
+                     geometry->middle_point.y < labels_min.y || geometry->middle_point.y > labels_max.y)) {
+                    continue;
+                }
+                edge_t *edge = adjacency_edge(adj, geometry->orig, geometry->index);
+
+                v2f v1 = add_v2f(frame_translation, geometry->v1);
+                v2f v2 = add_v2f(frame_translation, geometry->v2);
+                v2f middle_point = add_v2f(frame_translation, geometry->middle_point);
+                edge->weight_pos_screen = get_edge_weight_pos(&global_state, v1, v2, middle_point, geometry->curved);
+
+                char w[10];
+                sprintf(w, "%d", edge->weight);
+                font_push_text(&global_state.font_batch, edge->weight_pos_screen.x, edge->weight_pos_screen.y, w,
+                               0, 0, 0, true);
             }
+
+            // vertex and edge weights
+            font_flush(&global_state.font_batch, &global_state.stream);
         }
 
         // draw help menu
@@ -1138,9 +2114,6 @@ int main(int argc, char **argv) {
             glDisable(GL_DEPTH_TEST);
             glUseProgram(shader_program);
             glUniform3f(translation_uniform, -DEFAULT_SCREEN_WIDTH/2, DEFAULT_SCREEN_HEIGHT/2, 0);
-            glUniform1i(filled_uniform, 0);
-            glUniform2f(fill_entrance_uniform, 0, 0);
-            glUniform1f(fill_radius_uniform, 0);
             glUniform1f(scale_uniform, 1/(DEFAULT_SCREEN_WIDTH/2.0f));
             glUniform3f(color_uniform, 0.7f, 0.7f, 0.7f);
 
@@ -1153,51 +2126,75 @@ int main(int argc, char **argv) {
             v2f pos = create_v2f(DEFAULT_SCREEN_WIDTH - 500, 100);
             float line_height = FONT_SIZE + 1.0f;
             int line_count = 0;
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "      Comandos:", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++), "", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  A               Adiciona um vertice", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  D               Deleta um vertice", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  C               Completa o grafo com arestas de valor 1",
-                                      0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  R               Randomiza todos os pesos do grafo", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  CTRL        Arraste para adicionar uma aresta", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  X               Altera o peso de um vertice/aresta", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  B               Executa um BFS comecando no vertice do cursor",
-                                      0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  SCROLL   Zoom", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  MOUSE2  Arrastar a tela", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  E               Exportar para arquivo", 0, 0, 0, false);
-            font_render_text_horrible(font_shader_program, global_state.font_vbo, global_state.font_vao, cdata,
-                                      ftex, pos.x, pos.y + line_height * (line_count++),
-                                      "  TAB          Esconde esse menu", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "      Comandos:", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  A               Adiciona um vertice", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  D               Deleta um vertice", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  C               Completa o grafo com arestas de valor 1",
+                           0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  R               Randomiza todos os pesos do grafo", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  CTRL        Arraste para adicionar uma aresta", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  SHIFT       Arraste para selecionar varios vertices", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  X               Altera o peso de um vertice/aresta", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  B               Executa um BFS comecando no vertice do cursor",
+                           0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  ESPACO  Pausa/continua a animacao do BFS", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  <- ->          Volta/avanca um nivel da animacao", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  SCROLL   Zoom", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  MOUSE2  Arrastar a tela", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  E               Exportar para arquivo", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  S               Salvar um snapshot binario", 0, 0, 0, false);
+            font_push_text(&global_state.font_batch, pos.x, pos.y + line_height * (line_count++),
+                           "  TAB          Esconde esse menu", 0, 0, 0, false);
+            font_flush(&global_state.font_batch, &global_state.stream);
+        }
+
+        // flood animation state
+        if (global_state.graph.current_animation_root != -1 && global_state.flood_batch.paused) {
+            char str[64];
+            int levels = graph_flood_levels_at(&global_state.graph, global_state.flood_batch.time);
+            sprintf(str, "BFS pausado: %d de %d niveis", levels, global_state.graph.flood_depth + 1);
+            font_push_text(&global_state.font_batch, 10, 10 + FONT_SIZE, str, 0, 0, 0, false);
+            font_flush(&global_state.font_batch, &global_state.stream);
+        }
+
+        // export progress
+        export_poll(&global_state, false);
+        if (global_state.export_job) {
+            char str[64];
+            sprintf(str, "Exportando... %d%%", (int) (100 * export_job_progress(global_state.export_job)));
+            font_push_text(&global_state.font_batch, 10, DEFAULT_SCREEN_HEIGHT - 10, str, 0, 0, 0, false);
+            font_flush(&global_state.font_batch, &global_state.stream);
         }
 
+        stream_end_frame(&global_state.stream);
         glfwSwapBuffers(window);
     }
 
+    stream_buffer_t *stream = &global_state.stream;
+    printf("Streamed %.1f MB in %d frames (%.1f KB per frame, waited for the gpu %d times)\n",
+           stream->total_bytes / (1024 * 1024), stream->total_frames,
+           stream->total_frames ? stream->total_bytes / 1024 / stream->total_frames : 0, stream->num_stalls);
+
+    // NOTE: a running export still has to reach the disk
+    export_poll(&global_state, true);
+
     glfwTerminate();
 
     return 0;
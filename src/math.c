@@ -13,40 +13,43 @@
 #define normalize(x) _normalize(x)
 #define scale(x) _scale(x)
 
+// NOTE: the functions are static inline because this file is included by more than one translation unit
+// (the graph library and the viewer)
+
 typedef struct {
     NUMERIC_TYPE x;
     NUMERIC_TYPE y;
 } TYPE_NAME;
 
-TYPE_NAME create(TYPE_NAME)(NUMERIC_TYPE x, NUMERIC_TYPE y) {
+static inline TYPE_NAME create(TYPE_NAME)(NUMERIC_TYPE x, NUMERIC_TYPE y) {
     TYPE_NAME v = {x, y};
     return v;
 }
 
-TYPE_NAME add(TYPE_NAME)(TYPE_NAME v1, TYPE_NAME v2) {
+static inline TYPE_NAME add(TYPE_NAME)(TYPE_NAME v1, TYPE_NAME v2) {
     TYPE_NAME v = {v1.x + v2.x, v1.y + v2.y};
     return v;
 }
 
-TYPE_NAME sub(TYPE_NAME)(TYPE_NAME v1, TYPE_NAME v2) {
+static inline TYPE_NAME sub(TYPE_NAME)(TYPE_NAME v1, TYPE_NAME v2) {
     TYPE_NAME v = {v1.x - v2.x, v1.y - v2.y};
     return v;
 }
 
-TYPE_NAME scale(TYPE_NAME)(TYPE_NAME v, NUMERIC_TYPE scalar) {
+static inline TYPE_NAME scale(TYPE_NAME)(TYPE_NAME v, NUMERIC_TYPE scalar) {
     TYPE_NAME r = {v.x * scalar, v.y * scalar};
     return r;
 }
 
-NUMERIC_TYPE dot(TYPE_NAME)(TYPE_NAME v1, TYPE_NAME v2) {
+static inline NUMERIC_TYPE dot(TYPE_NAME)(TYPE_NAME v1, TYPE_NAME v2) {
     return v1.x * v2.x + v1.y * v2.y;
 }
 
-NUMERIC_TYPE magnitude(TYPE_NAME)(TYPE_NAME v1) {
+static inline NUMERIC_TYPE magnitude(TYPE_NAME)(TYPE_NAME v1) {
     return sqrt(v1.x * v1.x + v1.y * v1.y);
 }
 
-TYPE_NAME normalize(TYPE_NAME)(TYPE_NAME v1) {
+static inline TYPE_NAME normalize(TYPE_NAME)(TYPE_NAME v1) {
     NUMERIC_TYPE mag = magnitude(TYPE_NAME)(v1);
     assert(mag);
     TYPE_NAME r = scale(TYPE_NAME)(v1, 1/mag);
@@ -0,0 +1,180 @@
+// binary graph snapshots
+//
+// a snapshot is a header followed by flat arrays, all in native byte order:
+//     double positions[2 * num_vertices] (x, y)
+//     int32_t vertex_weights[num_vertices]
+//     uint32_t offsets[num_vertices + 1] (csr: the edges of vertex i are offsets[i] .. offsets[i + 1])
+//     int32_t dests[num_edges] (sorted inside every vertex)
+//     int32_t weights[num_edges]
+//     uint32_t parent_offsets[num_vertices + 1] (the parents of vertex i are parent_offsets[i] .. parent_offsets[i + 1])
+//     int32_t parents[num_edges] (source of every in-edge, grouped by destination)
+//     uint8_t reciprocal[num_edges] (flag of every edge, in the same order as dests)
+// vertices are numbered densely (free slots are not stored). the file is memory-mapped when opened and
+// the arrays point straight into the mapping: loading copies them into the adjacency store as they are,
+// nothing is recomputed.
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#define SNAPSHOT_MAGIC "GRAPHSNP"
+#define SNAPSHOT_VERSION 2 // NOTE: version 1 did not store the parents and the reciprocal flags
+
+// optional sections of the header
+#define SNAPSHOT_HAS_VIEW 1 // zoom and translation
+#define SNAPSHOT_HAS_ANIMATION 2 // root of the flood animation
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t num_vertices;
+    uint32_t num_edges;
+    double zoom;
+    double translation_x;
+    double translation_y;
+    int32_t animation_root;
+    uint32_t reserved; // NOTE: keeps the arrays that follow 8-byte aligned
+} snapshot_header_t;
+
+typedef struct {
+    snapshot_header_t *header;
+    double *positions;
+    int32_t *vertex_weights;
+    uint32_t *offsets;
+    int32_t *dests;
+    int32_t *weights;
+    uint32_t *parent_offsets;
+    int32_t *parents;
+    uint8_t *reciprocal;
+
+    void *mapping;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE file_mapping;
+#endif
+} snapshot_t;
+
+// size of a snapshot with the given counts (header included)
+size_t snapshot_size(uint32_t num_vertices, uint32_t num_edges) {
+    return sizeof(snapshot_header_t) + num_vertices * (2 * sizeof(double) + sizeof(int32_t)) +
+           2 * ((size_t) num_vertices + 1) * sizeof(uint32_t) + 3 * (size_t) num_edges * sizeof(int32_t) +
+           num_edges * sizeof(uint8_t);
+}
+
+void snapshot_close(snapshot_t *snapshot) {
+#ifdef _WIN32
+    if (snapshot->mapping) {
+        UnmapViewOfFile(snapshot->mapping);
+        CloseHandle(snapshot->file_mapping);
+        CloseHandle(snapshot->file);
+    }
+#else
+    if (snapshot->mapping) {
+        munmap(snapshot->mapping, snapshot->size);
+    }
+#endif
+    snapshot->mapping = NULL;
+    snapshot->header = NULL;
+}
+
+// maps `filename` and checks that it is a valid snapshot, returns false otherwise
+// NOTE: the arrays are only valid until snapshot_close()
+bool snapshot_open(snapshot_t *snapshot, const char *filename) {
+    snapshot->mapping = NULL;
+    snapshot->header = NULL;
+
+#ifdef _WIN32
+    snapshot->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (snapshot->file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(snapshot->file, &file_size);
+    snapshot->size = (size_t) file_size.QuadPart;
+    snapshot->file_mapping = snapshot->size ? CreateFileMappingA(snapshot->file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    if (!snapshot->file_mapping) {
+        CloseHandle(snapshot->file);
+        return false;
+    }
+    snapshot->mapping = MapViewOfFile(snapshot->file_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!snapshot->mapping) {
+        CloseHandle(snapshot->file_mapping);
+        CloseHandle(snapshot->file);
+        return false;
+    }
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    snapshot->size = (size_t) st.st_size;
+    void *mapping = mmap(NULL, snapshot->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    snapshot->mapping = mapping;
+#endif
+
+    snapshot_header_t *header = snapshot->mapping;
+    if (snapshot->size < sizeof(*header) || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) ||
+        header->version != SNAPSHOT_VERSION ||
+        snapshot->size != snapshot_size(header->num_vertices, header->num_edges)) {
+        snapshot_close(snapshot);
+        return false;
+    }
+    snapshot->header = header;
+    snapshot->positions = (double *) (header + 1);
+    snapshot->vertex_weights = (int32_t *) (snapshot->positions + 2 * header->num_vertices);
+    snapshot->offsets = (uint32_t *) (snapshot->vertex_weights + header->num_vertices);
+    snapshot->dests = (int32_t *) (snapshot->offsets + header->num_vertices + 1);
+    snapshot->weights = snapshot->dests + header->num_edges;
+    snapshot->parent_offsets = (uint32_t *) (snapshot->weights + header->num_edges);
+    snapshot->parents = (int32_t *) (snapshot->parent_offsets + header->num_vertices + 1);
+    snapshot->reciprocal = (uint8_t *) (snapshot->parents + header->num_edges);
+
+    // NOTE: the csr arrays are used to index other arrays, so they are validated here once. that the parents
+    // and the flags agree with the edges is not checked (graph_save_snapshot writes them from the same store)
+    uint32_t *offsets = snapshot->offsets;
+    uint32_t *parent_offsets = snapshot->parent_offsets;
+    bool valid = offsets[0] == 0 && offsets[header->num_vertices] == header->num_edges &&
+                 parent_offsets[0] == 0 && parent_offsets[header->num_vertices] == header->num_edges;
+    for (uint32_t i = 0; valid && i < header->num_vertices; i++) {
+        valid = offsets[i] <= offsets[i + 1] && parent_offsets[i] <= parent_offsets[i + 1];
+    }
+    for (uint32_t i = 0; valid && i < header->num_edges; i++) {
+        valid = snapshot->dests[i] >= 0 && (uint32_t) snapshot->dests[i] < header->num_vertices &&
+                snapshot->parents[i] >= 0 && (uint32_t) snapshot->parents[i] < header->num_vertices &&
+                snapshot->reciprocal[i] <= 1;
+    }
+    if (!valid) {
+        snapshot_close(snapshot);
+        return false;
+    }
+    return true;
+}
+
+// returns true if `filename` starts like a snapshot (used to tell snapshots and text exports apart)
+bool snapshot_is_snapshot(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        return false;
+    }
+    char magic[8];
+    bool result = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && !memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic));
+    fclose(f);
+    return result;
+}
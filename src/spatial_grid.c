@@ -0,0 +1,264 @@
+// uniform grid over 2D points, used for picking things under the cursor
+//
+// the plane is divided in square cells of cell_size and every cell is hashed into a bucket, so the
+// grid works for unbounded coordinates with memory proportional to the number of points. entries
+// are identified by an integer id chosen by the caller.
+//
+// every bucket keeps the ids and the positions of its entries in two arrays, so the position scans go
+// through the batch kernels (kernels.c)
+//
+// NOTE: removing or moving an entry requires the exact position it was inserted with
+
+// NOTE: the types are declared in graph.h
+
+void grid_init(spatial_grid_t *grid, double cell_size) {
+    grid->num_buckets = 256;
+    grid->buckets = calloc(grid->num_buckets, sizeof(*grid->buckets));
+    assert(grid->buckets);
+    grid->cell_size = cell_size;
+    grid->num_entries = 0;
+    grid->results = NULL;
+    grid->results_capacity = 0;
+}
+
+void grid_destroy(spatial_grid_t *grid) {
+    for (int i = 0; i < grid->num_buckets; i++) {
+        free(grid->buckets[i].ids);
+        free(grid->buckets[i].positions);
+    }
+    free(grid->buckets);
+    free(grid->results);
+    grid->buckets = NULL;
+    grid->num_buckets = 0;
+    grid->num_entries = 0;
+    grid->results = NULL;
+    grid->results_capacity = 0;
+}
+
+// removes every entry (keeps the memory around)
+void grid_clear(spatial_grid_t *grid) {
+    for (int i = 0; i < grid->num_buckets; i++) {
+        grid->buckets[i].num_entries = 0;
+    }
+    grid->num_entries = 0;
+}
+
+int grid_cell_coord(spatial_grid_t *grid, double x) {
+    return (int) floor(x / grid->cell_size);
+}
+
+grid_bucket_t *grid_bucket(spatial_grid_t *grid, int cell_x, int cell_y) {
+    unsigned int hash = ((unsigned int) cell_x * 73856093u) ^ ((unsigned int) cell_y * 19349663u);
+    return &grid->buckets[hash & (grid->num_buckets - 1)];
+}
+
+void grid_bucket_push(grid_bucket_t *bucket, int id, v2f pos) {
+    if (bucket->num_entries == bucket->capacity) {
+        bucket->capacity = bucket->capacity ? bucket->capacity * 2 : 4;
+        bucket->ids = realloc(bucket->ids, bucket->capacity * sizeof(*bucket->ids));
+        bucket->positions = realloc(bucket->positions, bucket->capacity * sizeof(*bucket->positions));
+        assert(bucket->ids && bucket->positions);
+    }
+    bucket->ids[bucket->num_entries] = id;
+    bucket->positions[bucket->num_entries] = pos;
+    bucket->num_entries++;
+}
+
+// doubles the number of buckets and redistributes every entry
+void grid_grow(spatial_grid_t *grid) {
+    grid_bucket_t *old_buckets = grid->buckets;
+    int old_num_buckets = grid->num_buckets;
+
+    grid->num_buckets *= 2;
+    grid->buckets = calloc(grid->num_buckets, sizeof(*grid->buckets));
+    assert(grid->buckets);
+    for (int i = 0; i < old_num_buckets; i++) {
+        for (int j = 0; j < old_buckets[i].num_entries; j++) {
+            v2f pos = old_buckets[i].positions[j];
+            grid_bucket_t *bucket = grid_bucket(grid, grid_cell_coord(grid, pos.x), grid_cell_coord(grid, pos.y));
+            grid_bucket_push(bucket, old_buckets[i].ids[j], pos);
+        }
+        free(old_buckets[i].ids);
+        free(old_buckets[i].positions);
+    }
+    free(old_buckets);
+}
+
+void grid_insert(spatial_grid_t *grid, int id, v2f pos) {
+    if (grid->num_entries >= 2 * grid->num_buckets) {
+        grid_grow(grid);
+    }
+    grid_bucket_t *bucket = grid_bucket(grid, grid_cell_coord(grid, pos.x), grid_cell_coord(grid, pos.y));
+    grid_bucket_push(bucket, id, pos);
+    grid->num_entries++;
+}
+
+bool grid_remove(spatial_grid_t *grid, int id, v2f pos) {
+    grid_bucket_t *bucket = grid_bucket(grid, grid_cell_coord(grid, pos.x), grid_cell_coord(grid, pos.y));
+    for (int i = 0; i < bucket->num_entries; i++) {
+        if (bucket->ids[i] == id) {
+            bucket->num_entries--;
+            bucket->ids[i] = bucket->ids[bucket->num_entries];
+            bucket->positions[i] = bucket->positions[bucket->num_entries];
+            grid->num_entries--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void grid_move(spatial_grid_t *grid, int id, v2f old_pos, v2f new_pos) {
+    grid_bucket_t *old_bucket = grid_bucket(grid, grid_cell_coord(grid, old_pos.x), grid_cell_coord(grid, old_pos.y));
+    grid_bucket_t *new_bucket = grid_bucket(grid, grid_cell_coord(grid, new_pos.x), grid_cell_coord(grid, new_pos.y));
+    if (old_bucket == new_bucket) {
+        for (int i = 0; i < old_bucket->num_entries; i++) {
+            if (old_bucket->ids[i] == id) {
+                old_bucket->positions[i] = new_pos;
+                return;
+            }
+        }
+        assert(!"entry not found");
+    }
+    bool removed = grid_remove(grid, id, old_pos);
+    assert(removed);
+    grid_insert(grid, id, new_pos);
+}
+
+// calls `callback` for every entry of `bucket` within the radius
+void grid_query_bucket(grid_bucket_t *bucket, v2f pos, double radius_squared,
+                       void (*callback)(void *data, int id, v2f entry_pos), void *data) {
+    for (int j = 0; j < bucket->num_entries; j++) {
+        v2f p = sub_v2f(bucket->positions[j], pos);
+        if (p.x * p.x + p.y * p.y <= radius_squared) {
+            callback(data, bucket->ids[j], bucket->positions[j]);
+        }
+    }
+}
+
+// the cells a query of `radius` around `pos` has to look at, returns false if there are more of them than
+// buckets (every bucket should be scanned once instead)
+bool grid_query_cells(spatial_grid_t *grid, v2f pos, double radius, int *min_x, int *max_x, int *min_y, int *max_y) {
+    *min_x = grid_cell_coord(grid, pos.x - radius);
+    *max_x = grid_cell_coord(grid, pos.x + radius);
+    *min_y = grid_cell_coord(grid, pos.y - radius);
+    *max_y = grid_cell_coord(grid, pos.y + radius);
+    return (double) (*max_x - *min_x + 1) * (*max_y - *min_y + 1) <= grid->num_buckets;
+}
+
+// calls `callback` for every entry within `radius` of `pos`
+// NOTE: an entry can be visited more than once if two of the scanned cells share a bucket
+void grid_query_radius(spatial_grid_t *grid, v2f pos, double radius,
+                       void (*callback)(void *data, int id, v2f entry_pos), void *data) {
+    int min_x, max_x, min_y, max_y;
+    double radius_squared = radius * radius;
+
+    if (!grid_query_cells(grid, pos, radius, &min_x, &max_x, &min_y, &max_y)) {
+        // the query covers more cells than there are buckets, just scan everything once
+        for (int i = 0; i < grid->num_buckets; i++) {
+            grid_query_bucket(&grid->buckets[i], pos, radius_squared, callback, data);
+        }
+        return;
+    }
+
+    for (int cell_x = min_x; cell_x <= max_x; cell_x++) {
+        for (int cell_y = min_y; cell_y <= max_y; cell_y++) {
+            grid_query_bucket(grid_bucket(grid, cell_x, cell_y), pos, radius_squared, callback, data);
+        }
+    }
+}
+
+int grid_compare_ids(const void *a, const void *b) {
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+// finds the id of every entry inside [min, max] (borders included), the ids are left in grid->results in
+// increasing order and without repetitions, returns how many there are
+// NOTE: gives up and returns -1 if the rectangle covers more cells than there are buckets or holds more
+// than `max_results` entries, going linearly through everything is cheaper then
+int grid_query_rect(spatial_grid_t *grid, v2f min, v2f max, int max_results) {
+    int min_x = grid_cell_coord(grid, min.x);
+    int max_x = grid_cell_coord(grid, max.x);
+    int min_y = grid_cell_coord(grid, min.y);
+    int max_y = grid_cell_coord(grid, max.y);
+    if ((double) (max_x - min_x + 1) * (max_y - min_y + 1) > grid->num_buckets) {
+        return -1;
+    }
+
+    int count = 0;
+    for (int cell_x = min_x; cell_x <= max_x; cell_x++) {
+        for (int cell_y = min_y; cell_y <= max_y; cell_y++) {
+            grid_bucket_t *bucket = grid_bucket(grid, cell_x, cell_y);
+            if (count + bucket->num_entries > grid->results_capacity) {
+                grid->results_capacity = max(count + bucket->num_entries, 2 * grid->results_capacity);
+                grid->results = realloc(grid->results, grid->results_capacity * sizeof(*grid->results));
+                assert(grid->results);
+            }
+            int *found = &grid->results[count];
+            int num_found = kernel_in_rect(bucket->positions, bucket->num_entries, min, max, found);
+            for (int k = 0; k < num_found; k++) {
+                found[k] = bucket->ids[found[k]];
+            }
+            count += num_found;
+            if (count > max_results) {
+                return -1;
+            }
+        }
+    }
+
+    // NOTE: a bucket shared by two of the cells was scanned twice
+    qsort(grid->results, count, sizeof(*grid->results), grid_compare_ids);
+    int num_unique = 0;
+    for (int i = 0; i < count; i++) {
+        if (!num_unique || grid->results[i] != grid->results[num_unique - 1]) {
+            grid->results[num_unique++] = grid->results[i];
+        }
+    }
+    return num_unique;
+}
+
+typedef struct {
+    v2f pos;
+    int nearest_id;
+    double nearest_distance_squared;
+} grid_nearest_query_t;
+
+void grid_nearest_bucket(grid_nearest_query_t *query, grid_bucket_t *bucket) {
+    double distance_squared = query->nearest_distance_squared;
+    int j = kernel_nearest(bucket->positions, bucket->num_entries, query->pos, &distance_squared);
+    if (j == -1) {
+        return;
+    }
+    // NOTE: ties keep the lowest id, the kernel returns the first of them inside the bucket (which can also
+    // be as far as the current nearest one)
+    int id = bucket->ids[j];
+    for (int k = j + 1; k < bucket->num_entries; k++) {
+        v2f p = sub_v2f(bucket->positions[k], query->pos);
+        if (bucket->ids[k] < id && p.x * p.x + p.y * p.y == distance_squared) {
+            id = bucket->ids[k];
+        }
+    }
+    if (query->nearest_id == -1 || distance_squared < query->nearest_distance_squared || id < query->nearest_id) {
+        query->nearest_id = id;
+        query->nearest_distance_squared = distance_squared;
+    }
+}
+
+// returns the id of the entry nearest to `pos` within `radius`, or -1 if there is none
+int grid_find_nearest(spatial_grid_t *grid, v2f pos, double radius) {
+    grid_nearest_query_t query = {pos, -1, radius * radius};
+    int min_x, max_x, min_y, max_y;
+    if (!grid_query_cells(grid, pos, radius, &min_x, &max_x, &min_y, &max_y)) {
+        for (int i = 0; i < grid->num_buckets; i++) {
+            grid_nearest_bucket(&query, &grid->buckets[i]);
+        }
+        return query.nearest_id;
+    }
+    for (int cell_x = min_x; cell_x <= max_x; cell_x++) {
+        for (int cell_y = min_y; cell_y <= max_y; cell_y++) {
+            grid_nearest_bucket(&query, grid_bucket(grid, cell_x, cell_y));
+        }
+    }
+    return query.nearest_id;
+}
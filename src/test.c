@@ -0,0 +1,151 @@
+// checks the invariants of the adjacency store (see adjacency.c), runs without a window
+//
+// usage: test [SEED] [STEPS]
+// applies random vertex and edge additions/removals and compactions, mirrored on a plain adjacency matrix, and
+// checks the store against it after every compaction and at the end
+
+#include "graph.h"
+
+#define TEST_MAX_SLOTS 48
+
+// reference model: weight of orig -> dest plus one, 0 when there is no edge
+int test_matrix[TEST_MAX_SLOTS][TEST_MAX_SLOTS];
+bool test_alive[TEST_MAX_SLOTS];
+
+void test_fail(const char *message, int v) {
+    fprintf(stderr, "test failed: %s (vertex %d)\n", message, v);
+    exit(-1);
+}
+
+// checks every invariant the rest of the engine relies on, `compacted` means there must be no overflow left
+void test_check(adjacency_t *adj, bool compacted) {
+    int num_vertices = 0;
+    int num_edges = 0;
+    for (int v = 0; v < adj->num_rows; v++) {
+        if (adjacency_is_vertex(adj, v) != test_alive[v]) {
+            test_fail("wrong slot state", v);
+        }
+        num_vertices += test_alive[v];
+        adjacency_row_t *row = &adj->rows[v];
+        if (compacted && row->num_overflow) {
+            test_fail("overflow left after compaction", v);
+        }
+        // csr segments are sorted by destination
+        for (int k = 1; k < row->num_base; k++) {
+            if (adj->csr[row->start + k - 1].dest > adj->csr[row->start + k].dest) {
+                test_fail("unsorted csr segment", v);
+            }
+        }
+
+        // out-edges match the model, with the right reciprocal flags once compacted
+        int degree = 0;
+        for (int k = 0; k < adjacency_degree(adj, v); k++) {
+            edge_t *edge = adjacency_edge(adj, v, k);
+            if (test_matrix[v][edge->dest] != edge->weight + 1) {
+                test_fail("unexpected out-edge", v);
+            }
+            bool reciprocal = edge->dest != v && test_matrix[edge->dest][v];
+            if (compacted && edge->reciprocal != reciprocal) {
+                test_fail("wrong reciprocal flag", v);
+            }
+            if (adjacency_find_edge(adj, v, edge->dest) != edge) {
+                test_fail("edge not found", v);
+            }
+        }
+        for (int u = 0; u < TEST_MAX_SLOTS; u++) {
+            degree += test_matrix[v][u] != 0;
+        }
+        if (degree != adjacency_degree(adj, v)) {
+            test_fail("missing out-edge", v);
+        }
+        num_edges += degree;
+
+        // parents hold every source of an in-edge exactly once (there are no parallel edges here)
+        int in_degree = 0;
+        for (int u = 0; u < TEST_MAX_SLOTS; u++) {
+            in_degree += test_matrix[u][v] != 0;
+        }
+        if (in_degree != adjacency_in_degree(adj, v)) {
+            test_fail("wrong number of parents", v);
+        }
+        for (int k = 0; k < adjacency_in_degree(adj, v); k++) {
+            int parent = adjacency_parent(adj, v, k);
+            if (parent < 0 || parent >= TEST_MAX_SLOTS || !test_matrix[parent][v]) {
+                test_fail("parent without edge", v);
+            }
+        }
+    }
+    if (num_vertices != adj->num_vertices || num_edges != adj->num_edges) {
+        test_fail("wrong counts", -1);
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned seed = argc > 1 ? (unsigned) atoi(argv[1]) : 0;
+    int num_steps = argc > 2 ? atoi(argv[2]) : 200000;
+    srand(seed);
+
+    adjacency_t adj;
+    adjacency_init(&adj);
+    int num_compactions = 0;
+    int num_reused = 0;
+    for (int step = 0; step < num_steps; step++) {
+        int action = rand() % 100;
+        int u = rand() % TEST_MAX_SLOTS;
+        int v = rand() % TEST_MAX_SLOTS;
+        if (action < 8) {
+            // new vertices take the most recently freed slot first
+            int expected = adj.num_free_rows ? adj.free_rows[adj.num_free_rows - 1] : adj.num_rows;
+            if (expected == TEST_MAX_SLOTS) {
+                continue;
+            }
+            int num_rows = adj.num_rows;
+            int slot = adjacency_add_vertex(&adj);
+            if (slot != expected || (slot < num_rows && adj.num_rows != num_rows)) {
+                test_fail("free slot not reused", slot);
+            }
+            num_reused += slot < num_rows;
+            test_alive[slot] = true;
+        } else if (action < 12) {
+            if (!test_alive[u]) {
+                continue;
+            }
+            adjacency_remove_vertex(&adj, u);
+            test_alive[u] = false;
+            for (int i = 0; i < TEST_MAX_SLOTS; i++) {
+                test_matrix[u][i] = 0;
+                test_matrix[i][u] = 0;
+            }
+        } else if (action < 60) {
+            if (!test_alive[u] || !test_alive[v] || test_matrix[u][v]) {
+                continue;
+            }
+            // bulk insertions leave the flags to the next compaction, which the check accounts for
+            int weight = rand() % 10;
+            if (action < 30) {
+                adjacency_append_edge(&adj, u, v, weight);
+            } else {
+                adjacency_add_edge(&adj, u, v, weight);
+            }
+            test_matrix[u][v] = weight + 1;
+        } else if (action < 90) {
+            if (!test_alive[u] || !adjacency_degree(&adj, u)) {
+                continue;
+            }
+            int k = rand() % adjacency_degree(&adj, u);
+            test_matrix[u][adjacency_edge(&adj, u, k)->dest] = 0;
+            adjacency_remove_edge_at(&adj, u, k);
+        } else if (action < 92) {
+            adjacency_compact(&adj);
+            test_check(&adj, true);
+            num_compactions++;
+        } else {
+            test_check(&adj, false);
+        }
+    }
+    adjacency_compact(&adj);
+    test_check(&adj, true);
+    adjacency_destroy(&adj);
+    printf("test: %d steps, %d compactions, %d reused slots, ok\n", num_steps, num_compactions, num_reused);
+    return 0;
+}